@@ -0,0 +1,305 @@
+/* 046267 Computer Architecture - Winter 20/21 - HW #2 */
+
+#include <cstdlib>
+#include <cstdio>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "simulator.h"
+#include "binaryTrace.h"
+#include "stackDistance.h"
+#include "workload.h"
+
+using std::string;
+using std::cout;
+using std::cerr;
+using std::endl;
+
+/*	the simulator's benchmark: the accesses per second of the whole memory, for representative
+	geometries (direct-mapped, 8-way and fully-associative; small and huge) under synthetic
+	workloads - and of its separate stages: generating a workload, parsing a trace, looking a
+	block up, filling one in (with an eviction). the results are written as JSON, and compared
+	with those of an earlier run, to follow the speed of the simulator from commit to commit.
+	usage: cacheSimBench [--quick] [--accesses N] [--json <file>] [--label <text>] [--baseline <file>]	*/
+
+// log2 of the block size of every case
+static const unsigned long int BENCH_BLOCK_BITS = 6;
+
+/* a geometry of a case: L1 and L2 sizes, and their associativity (ALL_WAYS for a fully-associative level) */
+static const unsigned long int ALL_WAYS = ~0ul;
+struct Geometry {
+	const char* name;
+	unsigned long int l1Size;
+	unsigned long int l2Size;
+	unsigned long int assoc;
+};
+
+static const Geometry GEOMETRIES[] = {
+	{ "small-direct", 14, 18, 0 },  { "small-8way", 14, 18, 3 },  { "small-full", 14, 18, ALL_WAYS },
+	{ "huge-direct", 20, 26, 0 },   { "huge-8way", 20, 26, 3 },   { "huge-full", 20, 26, ALL_WAYS },
+};
+
+
+/* the result of a case */
+struct BenchResult {
+	string name;
+	unsigned long int accesses;
+	double seconds;
+	bool failed;	// a check of the case (its hits or misses, or the accesses it decoded) failed
+
+	double rate() const { return seconds > 0 ? accesses / seconds : 0; }
+};
+
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+static unsigned long int assocOf(const Geometry& geometry, unsigned long int size) {
+	return geometry.assoc == ALL_WAYS ? size - BENCH_BLOCK_BITS : geometry.assoc;
+}
+
+
+static MemoryConfig configOf(const Geometry& geometry) {
+	MemoryConfig config;
+	config.set("--mem-cyc", 100);
+	config.set("--bsize", BENCH_BLOCK_BITS);
+	config.set("--wr-alloc", 1);
+	config.set("--l1-size", geometry.l1Size);
+	config.set("--l1-assoc", assocOf(geometry, geometry.l1Size));
+	config.set("--l1-cyc", 1);
+	config.set("--l2-size", geometry.l2Size);
+	config.set("--l2-assoc", assocOf(geometry, geometry.l2Size));
+	config.set("--l2-cyc", 10);
+	return config;
+}
+
+
+/* the whole memory: the workload walks twice the size of L2 (a fifth of the accesses are writes).
+   the first quarter of the accesses warms the memory up, and the rest are timed */
+static BenchResult benchMemory(const Geometry& geometry, int kind, unsigned long int accessesNum) {
+	Workload workload(kind, geometry.l2Size + 1, BENCH_BLOCK_BITS, 5, 20);
+	std::vector<Access> accesses(accessesNum);
+	workload.fill(&accesses[0], accesses.size());
+
+	Simulator simulator(configOf(geometry));
+	std::size_t warmup = accessesNum / 4;
+	simulator.accessBatch(&accesses[0], warmup);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	simulator.accessBatch(&accesses[warmup], accessesNum - warmup);
+
+	BenchResult result = { string("memory/") + geometry.name + "/" + WORKLOAD_NAMES[kind], accessesNum - warmup,
+	                       secondsSince(start), false };
+	return result;
+}
+
+
+/* a single level (L1 of the geometry): looking up blocks that it holds - every access hits */
+static BenchResult benchLookup(const Geometry& geometry, unsigned long int accessesNum) {
+	Cache cache(assocOf(geometry, geometry.l1Size), geometry.l1Size, BENCH_BLOCK_BITS, 0);
+	Workload resident(SEQUENTIAL, geometry.l1Size, BENCH_BLOCK_BITS);
+	std::vector<Access> accesses(1ul << (geometry.l1Size - BENCH_BLOCK_BITS));
+	resident.fill(&accesses[0], accesses.size());
+	for (std::size_t i = 0; i < accesses.size(); ++i) accessSingleLevel(cache, accesses[i].address);
+
+	Workload workload(UNIFORM, geometry.l1Size, BENCH_BLOCK_BITS);
+	accesses.resize(accessesNum);
+	workload.fill(&accesses[0], accesses.size());
+	unsigned long int found = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < accesses.size(); ++i) {
+		unsigned int slot = cache.getBlock(accesses[i].address);
+		if (slot != NO_SLOT) {
+			cache.touch(slot);
+			++found;
+		}
+	}
+	BenchResult result = { string("lookup/") + geometry.name, accessesNum, secondsSince(start), false };
+	if (found != accessesNum) {
+		cerr << result.name << ": " << accessesNum - found << " unexpected misses" << endl;
+		result.failed = true;
+	}
+	return result;
+}
+
+
+/* a single level (L1 of the geometry): a scan of 4 times its size - every access misses, and
+   (once the level is full) fills its block in instead of a victim */
+static BenchResult benchFill(const Geometry& geometry, unsigned long int accessesNum) {
+	Cache cache(assocOf(geometry, geometry.l1Size), geometry.l1Size, BENCH_BLOCK_BITS, 0);
+	Workload workload(SEQUENTIAL, geometry.l1Size + 2, BENCH_BLOCK_BITS);
+	std::vector<Access> accesses(accessesNum);
+	workload.fill(&accesses[0], accesses.size());
+	unsigned long int hits = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < accesses.size(); ++i) {
+		hits += accessSingleLevel(cache, accesses[i].address);
+	}
+	BenchResult result = { string("fill-evict/") + geometry.name, accessesNum, secondsSince(start), false };
+	if (hits != 0) {
+		cerr << result.name << ": " << hits << " unexpected hits" << endl;
+		result.failed = true;
+	}
+	return result;
+}
+
+
+/* generating a workload (a fifth of the accesses are writes) into batches - with nothing to simulate them */
+static BenchResult benchGenerate(int kind, unsigned long int accessesNum) {
+	Workload workload(kind, 30, BENCH_BLOCK_BITS, 5, 20);
+	Access batch[TRACE_BATCH];
+	unsigned long int checksum = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (unsigned long int batches = 0; batches * TRACE_BATCH < accessesNum; ++batches) {
+		workload.fill(batch, TRACE_BATCH);
+		checksum += batch[TRACE_BATCH - 1].address;
+	}
+	unsigned long int generated = (accessesNum + TRACE_BATCH - 1) / TRACE_BATCH * TRACE_BATCH;
+	BenchResult result = { string("generate/") + WORKLOAD_NAMES[kind], generated, secondsSince(start), false };
+	if (checksum == 1) cerr << result.name << ": " << checksum << endl; // keeps the batches alive
+	return result;
+}
+
+
+/* parsing a trace of uniform accesses (text, and binary with each codec) out of a file */
+template<class Reader>
+static BenchResult benchParse(const char* name, const char* path, unsigned long int accessesNum) {
+	Reader trace(path);
+	Access batch[TRACE_BATCH];
+	unsigned long int decoded = 0;
+	std::size_t batchSize;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	while ((batchSize = trace.read(batch, TRACE_BATCH)) > 0) decoded += batchSize;
+	BenchResult result = { string("parse/") + name, decoded, secondsSince(start), false };
+	if (decoded != accessesNum || trace.failed()) {
+		cerr << result.name << ": decoded " << decoded << " accesses" << endl;
+		result.failed = true;
+	}
+	return result;
+}
+
+
+static bool benchParsing(unsigned long int accessesNum, std::vector<BenchResult>& results) {
+	const char* textPath = "cacheSimBench.trace";
+	const char* lzPath = "cacheSimBench.lz.bin";
+	const char* rawPath = "cacheSimBench.raw.bin";
+	Workload workload(UNIFORM, 32, 2, 1, 30);
+	std::vector<Access> accesses(accessesNum);
+	workload.fill(&accesses[0], accesses.size());
+
+	FILE* text = fopen(textPath, "w");
+	BinaryTraceWriter lz(lzPath, CODEC_LZ);
+	BinaryTraceWriter raw(rawPath, CODEC_NONE);
+	if (text == NULL || !lz.good() || !raw.good()) {
+		cerr << "cannot write the traces to parse" << endl;
+		if (text != NULL) fclose(text);
+		return false;
+	}
+	for (std::size_t i = 0; i < accesses.size(); ++i) {
+		fprintf(text, "%c 0x%lx\n", accesses[i].operation, accesses[i].address);
+		lz.write(accesses[i]);
+		raw.write(accesses[i]);
+	}
+	fclose(text);
+	lz.close();
+	raw.close();
+
+	results.push_back(benchParse<TraceReader>("text", textPath, accessesNum));
+	results.push_back(benchParse<BinaryTraceReader>("binary-lz", lzPath, accessesNum));
+	results.push_back(benchParse<BinaryTraceReader>("binary-raw", rawPath, accessesNum));
+	remove(textPath);
+	remove(lzPath);
+	remove(rawPath);
+	return true;
+}
+
+
+/* reads the accesses per second of every case out of a JSON file that this benchmark wrote
+   (a result per line) */
+static std::map<string, double> readBaseline(const char* path) {
+	std::map<string, double> rates;
+	std::ifstream file(path);
+	string line;
+	while (std::getline(file, line)) {
+		string::size_type name = line.find("\"name\": \"");
+		string::size_type rate = line.find("\"accesses_per_sec\": ");
+		if (name == string::npos || rate == string::npos) continue;
+		name += 9;
+		rates[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + rate + 20);
+	}
+	return rates;
+}
+
+
+static bool writeJson(const char* path, const string& label, const std::vector<BenchResult>& results) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) return false;
+	fprintf(file, "{\n  \"label\": \"%s\",\n  \"results\": [\n", label.c_str());
+	for (std::size_t r = 0; r < results.size(); ++r) {
+		fprintf(file, "    {\"name\": \"%s\", \"accesses\": %lu, \"seconds\": %.6f, \"accesses_per_sec\": %.0f}%s\n",
+		        results[r].name.c_str(), results[r].accesses, results[r].seconds, results[r].rate(),
+		        r + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+
+int main(int argc, char **argv) {
+	unsigned long int accessesNum = 4000000;
+	const char* jsonPath = NULL;
+	const char* baselinePath = NULL;
+	string label;
+	bool quick = false;
+	for (int i = 1; i < argc; ++i) {
+		string flag(argv[i]);
+		if (flag == "--quick") quick = true;
+		else if (i + 1 < argc && flag == "--accesses") accessesNum = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && flag == "--json") jsonPath = argv[++i];
+		else if (i + 1 < argc && flag == "--label") label = argv[++i];
+		else if (i + 1 < argc && flag == "--baseline") baselinePath = argv[++i];
+		else {
+			cerr << "Usage: cacheSimBench [--quick] [--accesses N] [--json <file>] [--label <text>] [--baseline <file>]" << endl;
+			return 1;
+		}
+	}
+	// --quick is a smoke run: the small geometries, and a few accesses
+	if (quick) accessesNum = 20000;
+	if (accessesNum < 4) accessesNum = 4;
+
+	std::vector<BenchResult> results;
+	bool failed = !benchParsing(accessesNum, results);
+	for (int kind = 0; kind < WORKLOADS_NUM; ++kind) {
+		results.push_back(benchGenerate(kind, 16 * accessesNum));
+	}
+	for (std::size_t g = 0; g < sizeof(GEOMETRIES) / sizeof(GEOMETRIES[0]); ++g) {
+		const Geometry& geometry = GEOMETRIES[g];
+		if (quick && geometry.l2Size > 18) continue;
+		results.push_back(benchLookup(geometry, accessesNum));
+		results.push_back(benchFill(geometry, accessesNum));
+		for (int kind = 0; kind < WORKLOADS_NUM; ++kind) {
+			results.push_back(benchMemory(geometry, kind, accessesNum));
+		}
+	}
+
+	std::map<string, double> baseline;
+	if (baselinePath != NULL) baseline = readBaseline(baselinePath);
+	for (std::size_t r = 0; r < results.size(); ++r) {
+		printf("%-32s %12.0f accesses/sec", results[r].name.c_str(), results[r].rate());
+		std::map<string, double>::const_iterator before = baseline.find(results[r].name);
+		if (before != baseline.end() && before->second > 0) printf("   x%.2f", results[r].rate() / before->second);
+		printf("\n");
+		failed = failed || results[r].failed;
+	}
+	if (jsonPath != NULL && !writeJson(jsonPath, label, results)) {
+		cerr << "Could not write " << jsonPath << endl;
+		return 1;
+	}
+	// a failed check fails the run (and so the benchmark's smoke test)
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,406 @@
+#ifndef BINARY_TRACE_H_
+#define BINARY_TRACE_H_
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "traceReader.h"
+
+
+/*      the binary trace format:
+            header:  "CSIMBTRC" | u32 version | u32 records-per-chunk
+            chunks:  u32 records | u32 raw size | u32 stored size | u32 codec | stored bytes
+        all integers are little-endian. the raw bytes of a chunk are one varint per access:
+        the first byte holds the operation bit (bit 0), 6 bits of the zigzag-encoded delta
+        from the previous address of the chunk and a continuation bit (bit 7); every next
+        byte holds 7 more bits. chunks are independent, so they are decoded one at a time     */
+//=======================================================================================
+static const char BINARY_TRACE_MAGIC[8] = { 'C','S','I','M','B','T','R','C' };
+static const std::uint32_t BINARY_TRACE_VERSION = 1;
+static const std::uint32_t BINARY_CHUNK_RECORDS = 1 << 16;
+static const std::size_t BINARY_HEADER_SIZE = 16;
+static const std::size_t BINARY_CHUNK_HEADER_SIZE = 16;
+static const std::size_t MAX_ACCESS_BYTES = 10;     // the varint of a 64-bit delta
+
+static const std::uint32_t CODEC_NONE = 0;
+static const std::uint32_t CODEC_LZ = 1;
+
+
+inline void putU32(unsigned char* out, std::uint32_t value){
+    for( int i=0 ; i<4 ; ++i ) out[i] = (unsigned char)(value >> (8*i));
+}
+
+inline std::uint32_t getU32(const unsigned char* in){
+    return std::uint32_t(in[0]) | std::uint32_t(in[1])<<8 | std::uint32_t(in[2])<<16 | std::uint32_t(in[3])<<24;
+}
+
+
+// checks if the file starts with the binary-trace magic
+inline bool isBinaryTrace(const char* path){
+    char magic[sizeof(BINARY_TRACE_MAGIC)];
+    std::FILE* file = std::fopen(path, "rb");
+    if( file==NULL ) return false;
+    bool binary = std::fread(magic, 1, sizeof(magic), file)==sizeof(magic)
+               && std::memcmp(magic, BINARY_TRACE_MAGIC, sizeof(magic))==0;
+    std::fclose(file);
+    return binary;
+}
+
+
+
+
+
+/*      a small in-tree LZ77 codec (LZ4-style sequences) for the chunks' raw bytes.
+        a sequence is: token (literals-length:4 | match-length-4:4), extra literal-length
+        bytes, the literals, a u16 offset and extra match-length bytes. the last sequence
+        of a block carries literals only                                                   */
+//=======================================================================================
+static const std::size_t LZ_MIN_MATCH = 4;
+static const std::size_t LZ_MAX_OFFSET = 65535;
+static const unsigned int LZ_HASH_BITS = 14;
+
+
+inline void lzPutLength(std::vector<unsigned char>& out, std::size_t length){
+    for( ; length>=255 ; length-=255 ) out.push_back(255);
+    out.push_back( (unsigned char)length );
+}
+
+
+inline void lzPutSequence(std::vector<unsigned char>& out, const unsigned char* literals, std::size_t literalsNum,
+                          std::size_t offset, std::size_t matchLength){
+    unsigned char token = (unsigned char)( (literalsNum<15 ? literalsNum : 15) << 4 );
+    if( matchLength!=0 ) token |= (matchLength-LZ_MIN_MATCH<15) ? (matchLength-LZ_MIN_MATCH) : 15;
+    out.push_back(token);
+    if( literalsNum>=15 ) lzPutLength(out, literalsNum-15);
+    out.insert(out.end(), literals, literals+literalsNum);
+    if( matchLength==0 ) return;
+    out.push_back( (unsigned char)offset );
+    out.push_back( (unsigned char)(offset >> 8) );
+    if( matchLength-LZ_MIN_MATCH>=15 ) lzPutLength(out, matchLength-LZ_MIN_MATCH-15);
+}
+
+
+// compresses 'size' bytes of 'in' into 'out' (replacing its content)
+inline void lzCompress(const unsigned char* in, std::size_t size, std::vector<unsigned char>& out){
+    std::vector<std::uint32_t> lastSeen(1u << LZ_HASH_BITS, 0); // position+1 of the last 4-byte sequence
+    out.clear();
+    std::size_t anchor = 0;
+    std::size_t i = 0;
+    while( i+LZ_MIN_MATCH <= size ){
+        std::uint32_t sequence;
+        std::memcpy(&sequence, in+i, sizeof(sequence));
+        std::uint32_t hash = (sequence * 2654435761u) >> (32-LZ_HASH_BITS);
+        std::size_t candidate = lastSeen[hash];
+        lastSeen[hash] = i+1;
+
+        if( candidate==0 || i-(candidate-1)>LZ_MAX_OFFSET || std::memcmp(in+candidate-1, in+i, LZ_MIN_MATCH)!=0 ){
+            ++i;
+            continue;
+        }
+        std::size_t match = candidate-1;
+        std::size_t length = LZ_MIN_MATCH;
+        while( i+length<size && in[match+length]==in[i+length] ) ++length;
+
+        lzPutSequence(out, in+anchor, i-anchor, i-match, length);
+        i += length;
+        anchor = i;
+    }
+    lzPutSequence(out, in+anchor, size-anchor, 0, 0);
+}
+
+
+inline bool lzGetLength(const unsigned char*& in, const unsigned char* end, std::size_t& length){
+    unsigned char byte;
+    do{
+        if( in==end ) return false;
+        byte = *in++;
+        length += byte;
+    }while( byte==255 );
+    return true;
+}
+
+
+// the largest block that 'size' bytes may be compressed into (when they hold no match at all)
+inline std::size_t lzBound(std::size_t size){
+    return size + size/255 + 16;
+}
+
+
+// decompresses a block into exactly 'size' bytes of 'out'. returns false if the block is corrupted
+inline bool lzDecompress(const unsigned char* in, std::size_t storedSize, unsigned char* out, std::size_t size){
+    const unsigned char* end = in + storedSize;
+    std::size_t produced = 0;
+    while( in<end ){
+        unsigned char token = *in++;
+        std::size_t literalsNum = token >> 4;
+        if( literalsNum==15 && !lzGetLength(in, end, literalsNum) ) return false;
+        if( (std::size_t)(end-in)<literalsNum || size-produced<literalsNum ) return false;
+        std::memcpy(out+produced, in, literalsNum);
+        in += literalsNum;
+        produced += literalsNum;
+        if( in==end ) break; // the last sequence
+
+        if( end-in<2 ) return false;
+        std::size_t offset = in[0] | std::size_t(in[1]) << 8;
+        in += 2;
+        std::size_t length = (token & 15) + LZ_MIN_MATCH;
+        if( (token & 15)==15 && !lzGetLength(in, end, length) ) return false;
+        if( offset==0 || offset>produced || size-produced<length ) return false;
+        for( std::size_t k=0 ; k<length ; ++k, ++produced ){ // byte by byte: the ranges may overlap
+            out[produced] = out[produced-offset];
+        }
+    }
+    return produced==size;
+}
+
+
+
+
+
+/*      writes accesses as a binary trace, one chunk of BINARY_CHUNK_RECORDS at a time     */
+//=======================================================================================
+struct BinaryTraceWriter{
+// writer's data------------------
+    std::FILE* file;
+    const std::uint32_t codec;
+    std::vector<unsigned char> raw;
+    std::vector<unsigned char> packed;
+    std::uint32_t records;
+    unsigned long int previous;
+    bool ok;
+// for statistics-----------------
+    unsigned long int accessesNum;
+    unsigned long int bytesNum;
+// ------------------------------------------------------------------------------------
+    BinaryTraceWriter(const char* path, std::uint32_t codec) : file(std::fopen(path, "wb")), codec(codec),
+            records(0), previous(0), ok(file!=NULL), accessesNum(0), bytesNum(0){
+        if( !ok ) return;
+        raw.reserve( 2*BINARY_CHUNK_RECORDS );
+        unsigned char header[BINARY_HEADER_SIZE];
+        std::memcpy(header, BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC));
+        putU32(header+8, BINARY_TRACE_VERSION);
+        putU32(header+12, BINARY_CHUNK_RECORDS);
+        emit(header, sizeof(header));
+    }
+
+    ~BinaryTraceWriter(){
+        if( file!=NULL ) std::fclose(file);
+    }
+
+    bool good() const{
+        return ok;
+    }
+
+    void emit(const unsigned char* bytes, std::size_t size){
+        ok = ok && std::fwrite(bytes, 1, size, file)==size;
+        bytesNum += size;
+    }
+
+    void write(const Access& access){
+        std::uint64_t delta = std::uint64_t(access.address) - std::uint64_t(previous);
+        std::uint64_t zigzag = (delta << 1) ^ ( (delta >> 63) ? ~std::uint64_t(0) : 0 );
+        unsigned char first = (access.operation=='w') | (zigzag & 0x3F) << 1;
+        zigzag >>= 6;
+        raw.push_back( first | (zigzag ? 0x80 : 0) );
+        while( zigzag!=0 ){
+            raw.push_back( (zigzag & 0x7F) | (zigzag>>7 ? 0x80 : 0) );
+            zigzag >>= 7;
+        }
+        previous = access.address;
+        ++accessesNum;
+        if( ++records==BINARY_CHUNK_RECORDS ) flush();
+    }
+
+    void flush(){
+        if( records==0 ) return;
+        const unsigned char* stored = &raw[0];
+        std::size_t storedSize = raw.size();
+        std::uint32_t storedCodec = CODEC_NONE;
+        if( codec==CODEC_LZ ){
+            lzCompress(&raw[0], raw.size(), packed);
+            if( packed.size()<raw.size() ){ // incompressible chunks are kept raw
+                stored = &packed[0];
+                storedSize = packed.size();
+                storedCodec = CODEC_LZ;
+            }
+        }
+        unsigned char header[BINARY_CHUNK_HEADER_SIZE];
+        putU32(header, records);
+        putU32(header+4, raw.size());
+        putU32(header+8, storedSize);
+        putU32(header+12, storedCodec);
+        emit(header, sizeof(header));
+        emit(stored, storedSize);
+        raw.clear();
+        records = 0;
+        previous = 0;
+    }
+
+    // writes the last chunk. returns false if anything could not be written
+    bool close(){
+        flush();
+        if( file!=NULL ){
+            ok = (std::fclose(file)==0) && ok;
+            file = NULL;
+        }
+        return ok;
+    }
+};
+
+
+
+
+
+/*      streams a binary trace chunk by chunk, with the same interface as TraceReader.
+        'lineNumber' counts the decoded accesses (i.e. the line of the text trace)       */
+//=======================================================================================
+struct BinaryTraceReader{
+// reader's data------------------
+    std::FILE* file;
+    std::vector<unsigned char> stored;
+    std::vector<unsigned char> raw;
+    std::size_t rawCursor;
+    std::uint32_t recordsLeft;      // in the current chunk
+    std::uint32_t recordsNum;       // of the current chunk
+    std::uint32_t chunkRecords;     // records-per-chunk, as the header says
+    std::uint64_t chunkOffset;      // of the current chunk's header in the file
+    std::uint64_t fileOffset;       // of the next chunk's header
+    unsigned long int previous;
+// for error reporting------------
+    unsigned long int lineNumber;
+    std::string error;
+// ------------------------------------------------------------------------------------
+    explicit BinaryTraceReader(const char* path) : file(std::fopen(path, "rb")), rawCursor(0),
+            recordsLeft(0), recordsNum(0), chunkRecords(0), chunkOffset(BINARY_HEADER_SIZE),
+            fileOffset(BINARY_HEADER_SIZE), previous(0), lineNumber(0){
+        unsigned char header[BINARY_HEADER_SIZE];
+        if( file==NULL ) return;
+        if( std::fread(header, 1, sizeof(header), file)!=sizeof(header)
+                || std::memcmp(header, BINARY_TRACE_MAGIC, sizeof(BINARY_TRACE_MAGIC))!=0 ){
+            error = "not a binary trace";
+        }else if( getU32(header+8)!=BINARY_TRACE_VERSION ){
+            error = "unsupported binary trace version";
+        }else{
+            chunkRecords = getU32(header+12);
+        }
+    }
+
+    ~BinaryTraceReader(){
+        if( file!=NULL ) std::fclose(file);
+    }
+
+    bool good() const{
+        return file!=NULL;
+    }
+
+    bool failed() const{
+        return !error.empty();
+    }
+
+    // loads and decompresses the next chunk. returns false at the end of the trace
+    bool nextChunk(){
+        unsigned char header[BINARY_CHUNK_HEADER_SIZE];
+        chunkOffset = fileOffset;
+        std::size_t got = std::fread(header, 1, sizeof(header), file);
+        if( got==0 ) return false;
+        if( got!=sizeof(header) ){
+            error = "truncated chunk header";
+            return false;
+        }
+        std::uint32_t records = getU32(header);
+        std::uint32_t rawSize = getU32(header+4);
+        std::uint32_t storedSize = getU32(header+8);
+        std::uint32_t codec = getU32(header+12);
+        // the sizes are checked before anything is allocated by them
+        if( records>chunkRecords || rawSize>(std::uint64_t)records*MAX_ACCESS_BYTES || storedSize>lzBound(rawSize) ){
+            error = "corrupted chunk";
+            return false;
+        }
+
+        stored.resize(storedSize);
+        if( std::fread(stored.data(), 1, storedSize, file)!=storedSize ){
+            error = "truncated chunk";
+            return false;
+        }
+        if( codec==CODEC_NONE ){
+            raw.swap(stored);
+        }else if( codec==CODEC_LZ ){
+            raw.resize(rawSize);
+            if( !lzDecompress(stored.data(), storedSize, raw.data(), rawSize) ){
+                error = "corrupted chunk";
+                return false;
+            }
+        }else{
+            error = "unknown chunk codec";
+            return false;
+        }
+        if( raw.size()!=rawSize ){
+            error = "corrupted chunk";
+            return false;
+        }
+        fileOffset += BINARY_CHUNK_HEADER_SIZE + storedSize;
+        rawCursor = 0;
+        recordsLeft = records;
+        recordsNum = records;
+        previous = 0;
+        return true;
+    }
+
+
+    // the point right after the accesses that were read so far: inside the current chunk, or
+    // right after it
+    TraceOffset offset() const{
+        if( recordsLeft==0 ) return TraceOffset(BINARY_TRACE, fileOffset, 0, lineNumber);
+        std::uint32_t decoded = recordsNum - recordsLeft;
+        return TraceOffset(BINARY_TRACE, chunkOffset, decoded, lineNumber - decoded);
+    }
+
+
+    // resumes the reading from the point (of an offset() of this very trace): from its chunk on,
+    // skipping the accesses of the chunk before it. returns false if the trace does not reach it
+    bool seek(const TraceOffset& point){
+        if( point.format!=BINARY_TRACE || file==NULL || failed() || std::fseek(file, (long)point.bytes, SEEK_SET)!=0 ) return false;
+        chunkOffset = fileOffset = point.bytes;
+        recordsLeft = recordsNum = 0;
+        lineNumber = point.lineNumber;
+        return skipAccesses(*this, point.skip);
+    }
+
+    // decodes up to 'max' accesses into 'out'. returns 0 at the end of the trace or on error
+    std::size_t read(Access* out, std::size_t max){
+        std::size_t decoded = 0;
+        while( decoded<max && failed()==false ){
+            if( recordsLeft==0 && !nextChunk() ) break;
+
+            const unsigned char* in = raw.data();
+            const std::size_t end = raw.size();
+            for( ; decoded<max && recordsLeft!=0 ; ++decoded, --recordsLeft ){
+                if( rawCursor==end ){
+                    error = "chunk holds fewer accesses than its header says";
+                    return decoded;
+                }
+                unsigned char byte = in[rawCursor++];
+                char operation = (byte & 1) ? 'w' : 'r';
+                std::uint64_t zigzag = (byte >> 1) & 0x3F;
+                for( unsigned int shift=6 ; (byte & 0x80) && shift<64 ; shift+=7 ){
+                    if( rawCursor==end ){
+                        error = "truncated access";
+                        return decoded;
+                    }
+                    byte = in[rawCursor++];
+                    zigzag |= std::uint64_t(byte & 0x7F) << shift;
+                }
+                std::uint64_t delta = (zigzag >> 1) ^ ( (zigzag & 1) ? ~std::uint64_t(0) : 0 );
+                previous = (unsigned long int)(std::uint64_t(previous) + delta);
+                out[decoded].address = previous;
+                out[decoded].operation = operation;
+                ++lineNumber;
+            }
+        }
+        return decoded;
+    }
+};
+
+#endif          //  BINARY_TRACE_H_
@@ -1,142 +1,780 @@
 /* 046267 Computer Architecture - Winter 20/21 - HW #2 */
 
 #include <cstdlib>
+#include <cstdio>
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#include "cacheSim.h"
+#include "simulator.h"
+#include "traceReader.h"
+#include "binaryTrace.h"
+#include "sweep.h"
+#include "shards.h"
+#include "pipeline.h"
+#include "stackDistance.h"
+#include "multicore.h"
+#include "checkpoint.h"
+#include "intervalStats.h"
+#include "workload.h"
 
 using std::FILE;
 using std::string;
 using std::cout;
 using std::endl;
 using std::cerr;
-using std::ifstream;
-using std::stringstream;
 
-int main(int argc, char **argv) {
+/* runs the whole trace through the simulator, a batch at a time.
+   returns false if a line of the trace is not in the "operation address" format */
+template<class Reader>
+static bool simulate(Simulator& simulator, Reader& trace) {
+	Access batch[TRACE_BATCH];
+	std::size_t batchSize;
+	while ((batchSize = trace.read(batch, TRACE_BATCH)) > 0) {
+		simulator.accessBatch(batch, batchSize);
+	}
+	return !trace.failed();
+}
 
-	if (argc < 19) {
-		cerr << "Not enough arguments" << endl;
-		return 0;
+
+/* simulates the trace in the file with the given reader (text or binary).
+   returns false, after reporting it, if the trace is malformed */
+template<class Reader>
+static bool simulateFile(Simulator& simulator, const char* fileString) {
+	Reader trace(fileString);
+	if (!trace.failed() && simulate(simulator, trace)) {
+		return true;
 	}
+	// Operation appears in an Invalid format
+	cout << "Command Format error" << endl;
+	cerr << fileString << ":" << trace.lineNumber << ": " << trace.error << endl;
+	return false;
+}
 
-	// Get input arguments
 
-	// File
-	// Assuming it is the first argument
-	char* fileString = argv[1];
-	ifstream file(fileString); //input file stream
+/* simulates the trace in the file on up to threadsNum threads, one shard of the sets at a time.
+   returns false, after reporting it, if the trace is malformed */
+template<class Reader>
+static bool simulateFileSharded(ShardedMemory& sharded, const char* fileString, unsigned int threadsNum) {
+	Reader trace(fileString);
+	if (!trace.failed() && sharded.run(trace, threadsNum)) {
+		return true;
+	}
+	// Operation appears in an Invalid format
+	cout << "Command Format error" << endl;
+	cerr << fileString << ":" << trace.lineNumber << ": " << trace.error << endl;
+	return false;
+}
+
+
+/* the --convert mode: writes a text trace as a binary one, that later runs detect by itself
+   usage: cacheSim --convert <text trace> <binary trace> [--codec lz|none] */
+static int convertTrace(int argc, char **argv) {
+	std::uint32_t codec = CODEC_LZ;
+	if (argc == 6 && string(argv[4]) == "--codec" && string(argv[5]) == "none") {
+		codec = CODEC_NONE;
+	} else if (argc != 4 && !(argc == 6 && string(argv[4]) == "--codec" && string(argv[5]) == "lz")) {
+		cerr << "Usage: cacheSim --convert <text trace> <binary trace> [--codec lz|none]" << endl;
+		return 1;
+	}
+
+	TraceReader trace(argv[2]);
+	if (!trace.good()) {
+		cerr << "File not found" << endl;
+		return 1;
+	}
+	BinaryTraceWriter binary(argv[3], codec);
+	Access batch[TRACE_BATCH];
+	std::size_t batchSize;
+	while (binary.good() && (batchSize = trace.read(batch, TRACE_BATCH)) > 0) {
+		for (std::size_t i = 0; i < batchSize; ++i) {
+			binary.write(batch[i]);
+		}
+	}
+	if (trace.failed()) {
+		cerr << argv[2] << ":" << trace.lineNumber << ": " << trace.error << endl;
+		return 1;
+	}
+	if (!binary.close()) {
+		cerr << "Could not write " << argv[3] << endl;
+		return 1;
+	}
+	cout << "converted " << binary.accessesNum << " accesses into " << binary.bytesNum << " bytes" << endl;
+	return 0;
+}
+
+
+/* prints the statistics line of a simulated memory: the miss-rate of every level, and the average access time */
+static void printStatistics(const SimulatorStatistics& statistics) {
+	for (std::size_t i = 0; i < statistics.levels.size(); ++i) {
+		printf("L%dmiss=%.03f ", (int)i + 1, statistics.levels[i].missRate());
+	}
+	printf("AccTimeAvg=%.03f\n", statistics.averageAccessTime());
+
+	if (statistics.timed) {
+		printf("Cycles=%.0f AvgLatency=%.03f MemBandwidth=%.03f StallCycles=%.0f\n", statistics.cycles,
+		       statistics.averageLatency, statistics.bandwidth, statistics.stallCycles);
+	}
+
+	// a line for every level that prefetches
+	for (std::size_t i = 0; i < statistics.levels.size(); ++i) {
+		const LevelStatistics& level = statistics.levels[i];
+		if (!level.prefetching) continue;
+		printf("L%dprefetch issued=%lu useful=%lu late=%lu polluting=%lu\n", (int)i + 1, level.prefetchIssued,
+		       level.prefetchUseful, level.prefetchLate, level.prefetchPolluting);
+	}
+}
+
+
+/* describes a configuration by the command-line flags that produce it */
+static string describe(const MemoryConfig& config) {
+	char text[256];
+	snprintf(text, sizeof(text), "--mem-cyc %lu --bsize %lu --wr-alloc %d", config.memCyc, config.blockSize,
+	         (int)config.writeAllocate);
+	string description(text);
+	if (config.seed != MemoryConfig().seed) {
+		snprintf(text, sizeof(text), " --seed %lu", config.seed);
+		description += text;
+	}
+	if (config.timing) {
+		snprintf(text, sizeof(text), " --timing 1 --mem-bw %lu --wb-buffer %lu", config.memBandwidth,
+		         config.writeBufferSize);
+		description += text;
+	}
+	for (std::size_t i = 0; i < config.levels.size(); ++i) {
+		const LevelConfig& level = config.levels[i];
+		int n = (int)i + 1;
+		snprintf(text, sizeof(text), " --l%d-size %lu --l%d-assoc %lu --l%d-cyc %lu", n, level.size, n, level.assoc,
+		         n, level.cyc);
+		description += text;
+		if (level.writeAllocate >= 0) {
+			snprintf(text, sizeof(text), " --l%d-wr-alloc %d", n, level.writeAllocate);
+			description += text;
+		}
+		if (level.inclusion != INCLUSIVE) {
+			snprintf(text, sizeof(text), " --l%d-inclusion %d", n, level.inclusion);
+			description += text;
+		}
+		if (level.replacement != LRU) {
+			snprintf(text, sizeof(text), " --l%d-repl %d", n, level.replacement);
+			description += text;
+		}
+		if (config.timing) {
+			snprintf(text, sizeof(text), " --l%d-mshrs %lu", n, level.mshrs);
+			description += text;
+		}
+		if (level.prefetcher != NO_PREFETCH) {
+			snprintf(text, sizeof(text), " --l%d-prefetch %d --l%d-prefetch-degree %lu", n, level.prefetcher, n,
+			         level.prefetchDegree);
+			description += text;
+		}
+	}
+	return description;
+}
+
+
+/* parses a grid value-list such as "4,6,10-12" (commas separate values, '-' spans a range) */
+static bool parseValues(const string& text, std::vector<unsigned long int>& values) {
+	const char* p = text.c_str();
+	while (*p != '\0') {
+		char* end;
+		unsigned long int first = strtoul(p, &end, 10);
+		unsigned long int last = first;
+		if (end == p) return false;
+		if (*end == '-') {
+			p = end + 1;
+			last = strtoul(p, &end, 10);
+			if (end == p || last < first) return false;
+		}
+		for (unsigned long int value = first; value <= last; ++value) {
+			values.push_back(value);
+		}
+		if (*end != ',' && *end != '\0') return false;
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return !values.empty();
+}
+
+
+/* reads a list of configurations: one per line, written as the command-line flags.
+   blank lines and lines starting with '#' are skipped */
+static bool readConfigs(const char* path, std::vector<MemoryConfig>& configs) {
+	std::ifstream file(path);
 	string line;
-	if (!file || !file.good()) {
-		// File doesn't exist or some other error
+	unsigned long int lineNumber = 0;
+	if (!file) {
 		cerr << "File not found" << endl;
-		return 0;
+		return false;
+	}
+	while (getline(file, line)) {
+		++lineNumber;
+		std::istringstream flags(line);
+		string flag;
+		unsigned long int value;
+		MemoryConfig config;
+		if (!(flags >> flag) || flag[0] == '#') continue;
+		do {
+			if (!(flags >> value) || !config.set(flag, value)) {
+				cerr << path << ":" << lineNumber << ": bad configuration" << endl;
+				return false;
+			}
+		} while (flags >> flag);
+		configs.push_back(config);
 	}
+	return true;
+}
 
-	unsigned MemCyc = 0, BSize = 0, L1Size = 0, L2Size = 0, L1Assoc = 0,
-			L2Assoc = 0, L1Cyc = 0, L2Cyc = 0, WrAlloc = 0;
 
-	for (int i = 2; i < 19; i += 2) {
-		string s(argv[i]);
-		if (s == "--mem-cyc") {
-			MemCyc = atoi(argv[i + 1]);
-		} else if (s == "--bsize") {
-			BSize = atoi(argv[i + 1]);
-		} else if (s == "--l1-size") {
-			L1Size = atoi(argv[i + 1]);
-		} else if (s == "--l2-size") {
-			L2Size = atoi(argv[i + 1]);
-		} else if (s == "--l1-cyc") {
-			L1Cyc = atoi(argv[i + 1]);
-		} else if (s == "--l2-cyc") {
-			L2Cyc = atoi(argv[i + 1]);
-		} else if (s == "--l1-assoc") {
-			L1Assoc = atoi(argv[i + 1]);
-		} else if (s == "--l2-assoc") {
-			L2Assoc = atoi(argv[i + 1]);
-		} else if (s == "--wr-alloc") {
-			WrAlloc = atoi(argv[i + 1]);
+/* the --sweep mode: simulates many configurations over a single pass of the trace, in parallel.
+   usage: cacheSim --sweep <trace> [--threads N] --configs <file>
+          cacheSim --sweep <trace> [--threads N] <flag> <values> ...     (the grid of all combinations)
+   every configuration prints its flags followed by its statistics line */
+static int runSweep(int argc, char **argv) {
+	if (argc < 5) {
+		cerr << "Not enough arguments" << endl;
+		return 0;
+	}
+	const char* fileString = argv[2];
+	FILE* file = std::fopen(fileString, "rb");
+	if (file == NULL) {
+		cerr << "File not found" << endl;
+		return 0;
+	}
+	std::fclose(file);
+	unsigned int threadsNum = std::thread::hardware_concurrency();
+	std::vector<MemoryConfig> configs(1);
+	bool grid = true;
+
+	for (int i = 3; i < argc; i += 2) {
+		string flag(argv[i]);
+		std::vector<unsigned long int> values;
+		if (i + 1 == argc) {
+			cerr << "Error in arguments" << endl;
+			return 0;
+		}
+		if (flag == "--threads") {
+			threadsNum = atoi(argv[i + 1]);
+		} else if (flag == "--configs") {
+			grid = false;
+			configs.clear();
+			if (!readConfigs(argv[i + 1], configs)) return 0;
+		} else if (grid && parseValues(argv[i + 1], values) && MemoryConfig().set(flag, 0)) {
+			// every configuration so far is crossed with every value of this flag
+			std::vector<MemoryConfig> crossed;
+			for (std::size_t c = 0; c < configs.size(); ++c) {
+				for (std::size_t v = 0; v < values.size(); ++v) {
+					crossed.push_back(configs[c]);
+					crossed.back().set(flag, values[v]);
+				}
+			}
+			configs.swap(crossed);
 		} else {
 			cerr << "Error in arguments" << endl;
 			return 0;
 		}
 	}
 
-	/* initialize the Memory Data-Type: 2 level cache and main */
-	Memory memory(L1Assoc,L1Size,L1Cyc,L2Assoc,L2Size,L2Cyc,WrAlloc,BSize,MemCyc);
-	while (getline(file, line)) {
+	std::vector<MemoryConfig> valid;
+	for (std::size_t c = 0; c < configs.size(); ++c) {
+		if (configs[c].isValid()) {
+			valid.push_back(configs[c]);
+		} else {
+			cerr << "skipping invalid configuration: " << describe(configs[c]) << endl;
+		}
+	}
 
-		/* count the acsses to the memory */
-		++memory.acessNum;
+	Sweep sweep(valid);
+	bool traceOk;
+	if (isBinaryTrace(fileString)) {
+		BinaryTraceReader trace(fileString);
+		traceOk = trace.good() && !trace.failed() && sweep.run(trace, threadsNum);
+		if (!traceOk) cerr << fileString << ":" << trace.lineNumber << ": " << trace.error << endl;
+	} else {
+		TraceReader trace(fileString);
+		traceOk = trace.good() && sweep.run(trace, threadsNum);
+		if (!traceOk) cerr << fileString << ":" << trace.lineNumber << ": " << trace.error << endl;
+	}
+	if (!traceOk) {
+		cout << "Command Format error" << endl;
+		return 0;
+	}
 
-		stringstream ss(line);
-		string address_str;
-		char operation = 0; // read (R) or write (W)
-		if (!(ss >> operation >> address_str)) {
-			// Operation appears in an Invalid format
-			cout << "Command Format error" << endl;
+	for (std::size_t c = 0; c < valid.size(); ++c) {
+		printf("%s ", describe(valid[c]).c_str());
+		printStatistics(statisticsOf(*sweep.memories[c]));
+	}
+	return 0;
+}
+
+
+/* the --stack-distance mode: the LRU miss-ratio of every (set-index bits, associativity) geometry
+   with the given block size, out of a single pass over the trace.
+   usage: cacheSim --stack-distance <trace> --bsize <bits> [--max-set-bits S] [--max-assoc A] [--validate]
+   --validate also simulates every geometry with a stand-alone Cache, and fails on any difference */
+static int runStackDistance(int argc, char **argv) {
+	const char* fileString = argv[2];
+	unsigned long int blockBits = 0, maxSetBits = 12, maxAssoc = 8;
+	bool validate = false;
+	for (int i = 3; i < argc; ++i) {
+		string flag(argv[i]);
+		if (flag == "--validate") {
+			validate = true;
+		} else if (i + 1 < argc && flag == "--bsize") {
+			blockBits = atoi(argv[++i]);
+		} else if (i + 1 < argc && flag == "--max-set-bits") {
+			maxSetBits = atoi(argv[++i]);
+		} else if (i + 1 < argc && flag == "--max-assoc") {
+			maxAssoc = atoi(argv[++i]);
+		} else {
+			cerr << "Error in arguments" << endl;
 			return 0;
 		}
+	}
+	if (blockBits + maxSetBits >= 64 || maxAssoc > 24 || (validate && maxSetBits + maxAssoc >= 32)) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
+
+	// one engine (and, when validating, one Cache per associativity) for every count of set-index bits
+	std::vector< std::unique_ptr<StackDistance> > engines;
+	std::vector< std::unique_ptr<Cache> > references;
+	std::vector<unsigned long int> referenceMisses;
+	for (unsigned long int setBits = 0; setBits <= maxSetBits; ++setBits) {
+		engines.push_back(std::unique_ptr<StackDistance>(new StackDistance(blockBits, setBits, 1ul << maxAssoc)));
+		for (unsigned long int assoc = 0; validate && assoc <= maxAssoc; ++assoc) {
+			references.push_back(std::unique_ptr<Cache>(new Cache(assoc, blockBits + setBits + assoc, blockBits, 0)));
+			referenceMisses.push_back(0);
+		}
+	}
+
+	std::unique_ptr<BinaryTraceReader> binary;
+	std::unique_ptr<TraceReader> text;
+	if (isBinaryTrace(fileString)) binary.reset(new BinaryTraceReader(fileString));
+	else text.reset(new TraceReader(fileString));
+	if (!(binary ? binary->good() : text->good())) {
+		cerr << "File not found" << endl;
+		return 0;
+	}
+	Access batch[TRACE_BATCH];
+	std::size_t batchSize;
+	while ((batchSize = binary ? binary->read(batch, TRACE_BATCH) : text->read(batch, TRACE_BATCH)) > 0) {
+		for (std::size_t e = 0; e < engines.size(); ++e) {
+			for (std::size_t i = 0; i < batchSize; ++i) {
+				engines[e]->access(batch[i].address);
+			}
+		}
+		for (std::size_t r = 0; r < references.size(); ++r) {
+			for (std::size_t i = 0; i < batchSize; ++i) {
+				referenceMisses[r] += !accessSingleLevel(*references[r], batch[i].address);
+			}
+		}
+	}
+	if (binary ? binary->failed() : text->failed()) {
+		cout << "Command Format error" << endl;
+		cerr << fileString << ":" << (binary ? binary->lineNumber : text->lineNumber) << ": "
+		     << (binary ? binary->error : text->error) << endl;
+		return 0;
+	}
+
+	unsigned long int mismatches = 0;
+	for (unsigned long int setBits = 0; setBits <= maxSetBits; ++setBits) {
+		const StackDistance& engine = *engines[setBits];
+		for (unsigned long int assoc = 0; assoc <= maxAssoc; ++assoc) {
+			printf("--bsize %lu --size %lu --assoc %lu miss=%.03f", blockBits, blockBits + setBits + assoc, assoc,
+			       engine.missRate(1ul << assoc));
+			if (validate && referenceMisses[setBits * (maxAssoc + 1) + assoc] != engine.missNum(1ul << assoc)) {
+				printf(" MISMATCH (Cache missed %lu of %lu, stack distance %lu)",
+				       referenceMisses[setBits * (maxAssoc + 1) + assoc], engine.acssesNum, engine.missNum(1ul << assoc));
+				++mismatches;
+			}
+			printf("\n");
+		}
+	}
+	return (mismatches == 0) ? 0 : 1;
+}
 
-		/*					unComment this line if the benchmark's trace is required:			*/
-		//cout << memory.acessNum << ") operation: " << operation << endl;
 
-		string cutAddress = address_str.substr(2); // Removing the "0x" part of the address
+/* the options of a run that goes through the trace a segment at a time: the accesses of a
+   warmup that are not counted, the checkpoints that it saves or resumes, and the intervals of
+   its interval statistics */
+struct SegmentOptions {
+	unsigned long int warmup;			// accesses
+	unsigned long int checkpointEvery;		// accesses (0 for the end of the run only)
+	string checkpointPath;
+	string resumePath;
+	unsigned long int statsInterval;		// accesses (0 for no interval statistics)
+	string statsPath;				// stderr when empty
+	bool statsJson;
 
-		/*					unComment these 2 lines if the benchmark trace is required:			*/
-		//cout << ", address (hex)" << cutAddress << endl;
-		//cout << endl;
+	SegmentOptions() : warmup(0), checkpointEvery(0), statsInterval(0), statsJson(false) {}
+
+	bool segmented() const {
+		return warmup > 0 || !checkpointPath.empty() || !resumePath.empty() || statsInterval > 0;
+	}
+};
 
-		unsigned long int num = 0;
-		num = strtoul(cutAddress.c_str(), NULL, 16);
-		unsigned long int address = num;
-		
-		/******************************** MEMORY_HANDLE_STARTS **************************************/
-		/*******************************************************************************************/
 
-		
-		++memory.L1.acssesNum;
-		memory.totalTime += memory.L1.cyclesNum;
-		//--------------------------------------
-		if( memory.L1.containsBlockOf(address) ){
-			memory.L1_Hit(address,operation);
-			continue;
+/* simulates the trace in the file a segment at a time, up to the end of the warmup (when the
+   statistics are reset), up to every checkpoint and up to the end of every interval (that is
+   emitted into 'intervals', unless it is NULL). a resumed run skips the accesses that its
+   checkpoint went through, so it ends exactly as a run that was never stopped.
+   returns false, after reporting it, if the trace or a checkpoint fails */
+template<class Reader>
+static bool simulateFileInSegments(Simulator& simulator, const MemoryConfig& config, const char* fileString,
+                                   const SegmentOptions& options, IntervalStatistics* intervals) {
+	Memory& memory = simulator.memory;
+	Reader trace(fileString);
+	std::uint64_t position = 0;
+	if (!options.resumePath.empty()) {
+		TraceOffset offset;
+		if (!loadCheckpoint(options.resumePath, config, memory, position, offset)) {
+			cerr << options.resumePath << ": not a checkpoint of this configuration" << endl;
+			return false;
+		}
+		// the first interval starts from the loaded counters
+		if (intervals != NULL) intervals->restart(memory);
+		// the trace is read on from the checkpoint's offset, instead of parsing all the accesses before it
+		if (!trace.seek(offset) && !trace.failed()) {
+			cerr << fileString << ": not the trace of the checkpoint, or shorter than its " << position << " accesses" << endl;
+			return false;
 		}
-        else{ ++memory.L1.missNum;}
-	
+	}
+
+	bool traceOk = !trace.failed();
+	bool ended = false;
+	while (traceOk && !ended) {
+		std::uint64_t end = ~std::uint64_t(0);
+		if (position < options.warmup) end = options.warmup;
+		if (options.checkpointEvery > 0) end = std::min(end, (position / options.checkpointEvery + 1) * options.checkpointEvery);
+		if (intervals != NULL) end = std::min(end, (position / options.statsInterval + 1) * options.statsInterval);
 
-		++memory.L2.acssesNum;
-       	memory.totalTime += memory.L2.cyclesNum;
-		//--------------------------------------
-		if(  memory.L2.containsBlockOf(address) ){
-			memory.L2_Hit(address,operation);
-			continue;
+		LimitedReader<Reader> segment(trace, end - position);
+		traceOk = simulate(simulator, segment);
+		std::uint64_t simulated = (end - position) - segment.remaining;
+		position += simulated;
+		ended = (segment.remaining > 0);
+
+		// an interval ends at its K accesses, at the end of the warmup and at the end of the trace
+		bool warmedUp = traceOk && simulated > 0 && position == options.warmup;
+		if (intervals != NULL && traceOk && simulated > 0 && (position % options.statsInterval == 0 || warmedUp || ended)) {
+			intervals->emit(memory, position);
+		}
+		if (warmedUp) {
+			memory.resetStatistics();
+			if (intervals != NULL) intervals->restart(memory);
 		}
-		else{++memory.L2.missNum;}
+		if (traceOk && !ended && !options.checkpointPath.empty() && options.checkpointEvery > 0 &&
+		    position % options.checkpointEvery == 0 && !saveCheckpoint(options.checkpointPath, config, memory, position, trace.offset())) {
+			cerr << options.checkpointPath << ": the checkpoint could not be written" << endl;
+			return false;
+		}
+	}
+	if (!traceOk) {
+		// Operation appears in an Invalid format
+		cout << "Command Format error" << endl;
+		cerr << fileString << ":" << trace.lineNumber << ": " << trace.error << endl;
+		return false;
+	}
+	if (!options.checkpointPath.empty() && !saveCheckpoint(options.checkpointPath, config, memory, position, trace.offset())) {
+		cerr << options.checkpointPath << ": the checkpoint could not be written" << endl;
+		return false;
+	}
+	return true;
+}
 
 
-		memory.totalTime += memory.cyclesNum;
-		//--------------------------------------
-		memory.L1_and_L2_Miss(address,operation);
-		continue;
+/* one core's trace in the --multicore mode (text or binary), read a batch at a time */
+struct CoreTrace {
+	const char* fileString;
+	std::unique_ptr<BinaryTraceReader> binary;
+	std::unique_ptr<TraceReader> text;
+	Access batch[TRACE_BATCH];
+	std::size_t batchSize;
+	std::size_t position;
 
-		/*******************************************************************************************/
-		/******************************** MEMORY_HANDLE_ENDS **************************************/
+	explicit CoreTrace(const char* fileString) : fileString(fileString), batchSize(0), position(0) {
+		if (isBinaryTrace(fileString)) binary.reset(new BinaryTraceReader(fileString));
+		else text.reset(new TraceReader(fileString));
+	}
 
+	bool good() const { return binary ? binary->good() : text->good(); }
+	bool failed() const { return binary ? binary->failed() : text->failed(); }
 
-		// DEBUG - remove this line
-		cout << " (dec) " << num << endl;
+	// the next access of the core, or NULL at the end of its trace
+	const Access* next() {
+		if (position == batchSize) {
+			batchSize = binary ? binary->read(batch, TRACE_BATCH) : text->read(batch, TRACE_BATCH);
+			position = 0;
+			if (batchSize == 0) return NULL;
+		}
+		return &batch[position++];
+	}
+
+	void reportError() const {
+		cout << "Command Format error" << endl;
+		cerr << fileString << ":" << (binary ? binary->lineNumber : text->lineNumber) << ": "
+		     << (binary ? binary->error : text->error) << endl;
+	}
+};
 
+
+/* the --multicore mode: every trace is the access stream of a core with a private L1 (the --l1
+   flags), over a shared L2 (the --l2 flags) that keeps the L1s coherent with MESI. the cores take
+   turns, an access each, until all of their traces end.
+   usage: cacheSim --multicore --mem-cyc ... --wr-alloc ... [--l1-repl/--l2-repl P] [--seed S] --traces <trace0> <trace1> ... */
+static int runMultiCore(int argc, char **argv) {
+	MemoryConfig config;
+	int i = 2;
+	for (; i + 1 < argc && string(argv[i]) != "--traces"; i += 2) {
+		if (!config.set(argv[i], atoi(argv[i + 1]))) {
+			cerr << "Error in arguments" << endl;
+			return 0;
+		}
+	}
+	unsigned int coresNum = argc - (i + 1);
+	if (i >= argc || coresNum == 0 || coresNum > MAX_CORES || config.levels.size() != 2 || !config.isValid()) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
+
+	std::vector< std::unique_ptr<CoreTrace> > traces;
+	for (unsigned int c = 0; c < coresNum; ++c) {
+		traces.push_back(std::unique_ptr<CoreTrace>(new CoreTrace(argv[i + 1 + c])));
+		if (!traces[c]->good()) {
+			cerr << "File not found" << endl;
+			return 0;
+		}
+	}
+
+	MultiCore memory(config, coresNum);
+	std::vector<unsigned int> running;		// the cores whose traces did not end yet
+	for (unsigned int c = 0; c < coresNum; ++c) running.push_back(c);
+	while (!running.empty()) {
+		for (std::size_t r = 0; r < running.size();) {
+			unsigned int core = running[r];
+			const Access* access = traces[core]->next();
+			if (access == NULL) {
+				if (traces[core]->failed()) {
+					traces[core]->reportError();
+					return 0;
+				}
+				running.erase(running.begin() + r);
+				continue;
+			}
+			memory.access(core, access->address, access->operation);
+			++r;
+		}
 	}
 
-	double L1MissRate = (double)memory.L1.missNum/memory.L1.acssesNum;
-	double L2MissRate = (double)memory.L2.missNum/memory.L2.acssesNum;
-	double avgAccTime = (double)memory.totalTime/memory.acessNum;
+	for (unsigned int c = 0; c < coresNum; ++c) {
+		const CoreStatistics& core = memory.cores[c];
+		double L1MissRate = core.acssesNum == 0 ? 0 : (double)core.missNum / core.acssesNum;
+		double avgAccTime = core.acssesNum == 0 ? 0 : core.totalTime / core.acssesNum;
+		printf("Core%u L1miss=%.03f AccTimeAvg=%.03f\n", c, L1MissRate, avgAccTime);
+	}
+	double L2MissRate = memory.L2.acssesNum == 0 ? 0 : (double)memory.L2.missNum / memory.L2.acssesNum;
+	printf("L2miss=%.03f\n", L2MissRate);
+	printf("Invalidations=%lu Upgrades=%lu DirtyTransfers=%lu BackInvalidations=%lu\n",
+	       memory.invalidations, memory.upgrades, memory.dirtyTransfers, memory.backInvalidations);
+	return 0;
+}
+
+
+/* the flags of the memory that every run gives - the arguments 2..18 of a single run */
+static const char* const MANDATORY_FLAGS[] = { "--mem-cyc", "--bsize", "--wr-alloc", "--l1-size", "--l1-assoc",
+                                               "--l1-cyc", "--l2-size", "--l2-assoc", "--l2-cyc" };
+static const unsigned int MANDATORY_FLAGS_NUM = sizeof(MANDATORY_FLAGS) / sizeof(MANDATORY_FLAGS[0]);
+
+/* the bit of a mandatory flag (0 for any other flag), to collect the given ones in a mask */
+static unsigned int mandatoryBitOf(const string& flag) {
+	for (unsigned int f = 0; f < MANDATORY_FLAGS_NUM; ++f) {
+		if (flag == MANDATORY_FLAGS[f]) return 1u << f;
+	}
+	return 0;
+}
+
+
+/* the --workload mode: simulates a synthetic workload that is generated in process, with no trace.
+   usage: cacheSim --workload <name[:weight],...> --accesses N --footprint <log2 bytes> [--stride <blocks>]
+                   [--writes <percent>] [--workload-seed S] [--warmup N] <the flags of the memory>
+   the workloads are sequential, strided, uniform, zipfian and chase (a pointer chase); a mix of
+   them draws every access out of one of them, by their weights */
+static int runWorkload(int argc, char **argv) {
+	string spec(argv[2]);
+	unsigned long int accessesNum = 0, footprintBits = 0, stride = 1, writePercent = 0, seed = 1, warmup = 0;
+	MemoryConfig config;
+	unsigned int givenFlags = 0;
+	for (int i = 3; i < argc; i += 2) {
+		string flag(argv[i]);
+		if (i + 1 >= argc) {
+			cerr << "Error in arguments" << endl;
+			return 0;
+		}
+		unsigned long int value = strtoul(argv[i + 1], NULL, 10);
+		if (flag == "--accesses") accessesNum = value;
+		else if (flag == "--footprint") footprintBits = value;
+		else if (flag == "--stride") stride = value;
+		else if (flag == "--writes") writePercent = value;
+		else if (flag == "--workload-seed") seed = value;
+		else if (flag == "--warmup") warmup = value;
+		else if (!config.set(flag, value)) {
+			cerr << "Error in arguments" << endl;
+			return 0;
+		}
+		givenFlags |= mandatoryBitOf(flag);
+	}
+	// the memory is never left to the defaults of MemoryConfig: all of its mandatory flags are given
+	WorkloadMix workload;
+	if (givenFlags != (1u << MANDATORY_FLAGS_NUM) - 1 || !config.isValid() || accessesNum == 0 || footprintBits <= config.blockSize || footprintBits >= 64 || stride == 0 ||
+	    writePercent > 100 || !workload.parse(spec, footprintBits, config.blockSize, stride, writePercent, seed)) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
+
+	Simulator simulator(config);
+	if (warmup > 0) {
+		WorkloadReader warming(workload, warmup);
+		simulate(simulator, warming);
+		simulator.memory.resetStatistics();
+	}
+	WorkloadReader generated(workload, accessesNum);
+	simulate(simulator, generated);
+	printStatistics(simulator.statistics());
+	return 0;
+}
+
+
+int main(int argc, char **argv) {
+
+	if (argc >= 2 && string(argv[1]) == "--convert") {
+		return convertTrace(argc, argv);
+	}
+	if (argc >= 2 && string(argv[1]) == "--sweep") {
+		return runSweep(argc, argv);
+	}
+	if (argc >= 3 && string(argv[1]) == "--stack-distance") {
+		return runStackDistance(argc, argv);
+	}
+	if (argc >= 3 && string(argv[1]) == "--workload") {
+		return runWorkload(argc, argv);
+	}
+	if (argc >= 2 && string(argv[1]) == "--multicore") {
+		return runMultiCore(argc, argv);
+	}
+
+	if (argc < 19) {
+		cerr << "Not enough arguments" << endl;
+		return 0;
+	}
+
+	// Get input arguments
+
+	// File
+	// Assuming it is the first argument
+	char* fileString = argv[1];
+	std::FILE* file = std::fopen(fileString, "rb"); //input trace
+	if (file == NULL) {
+		// File doesn't exist or some other error
+		cerr << "File not found" << endl;
+		return 0;
+	}
+
+	std::fclose(file);
+
+	MemoryConfig config;
+	for (int i = 2; i < 19; i += 2) {
+		if (!config.set(argv[i], atoi(argv[i + 1]))) {
+			cerr << "Error in arguments" << endl;
+			return 0;
+		}
+	}
+
+	// optional flags after the configuration: deeper levels (--l3-size ...), per-level policies
+	// (--l2-wr-alloc, --l2-inclusion, --l2-repl, --l2-prefetch ...), --seed, the timing model
+	// (--timing 1, --mem-bw, --wb-buffer, --l2-mshrs ...), --threads, --pipeline, --warmup and the
+	// checkpoints (--checkpoint <file>, --checkpoint-every, --resume <file>) and the interval
+	// statistics (--stats-interval K, --stats-out <file>, --stats-format csv|json).
+	// unknown ones are ignored
+	unsigned int threadsNum = 1;
+	bool pipelined = false;
+	SegmentOptions segments;
+	for (int i = 19; i < argc; ++i) {
+		if (i + 1 < argc && string(argv[i]) == "--threads") threadsNum = atoi(argv[++i]);
+		else if (string(argv[i]) == "--pipeline") pipelined = true;
+		else if (i + 1 < argc && string(argv[i]) == "--warmup") segments.warmup = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && string(argv[i]) == "--checkpoint") segments.checkpointPath = argv[++i];
+		else if (i + 1 < argc && string(argv[i]) == "--checkpoint-every") segments.checkpointEvery = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && string(argv[i]) == "--resume") segments.resumePath = argv[++i];
+		else if (i + 1 < argc && string(argv[i]) == "--stats-interval") segments.statsInterval = strtoul(argv[++i], NULL, 10);
+		else if (i + 1 < argc && string(argv[i]) == "--stats-out") segments.statsPath = argv[++i];
+		else if (i + 1 < argc && string(argv[i]) == "--stats-format") segments.statsJson = (string(argv[++i]) == "json");
+		else if (i + 1 < argc && MemoryConfig().set(argv[i], 0)) {
+			config.set(argv[i], atoi(argv[i + 1]));
+			++i;
+		}
+	}
+	if (!config.isValid()) {
+		cerr << "Error in arguments" << endl;
+		return 0;
+	}
+
+	if (segments.segmented()) {
+		// the shards are neither checkpointed nor reported by intervals: a segmented run is a serial one
+		Simulator simulator(config);
+		std::FILE* statsFile = stderr;
+		if (!segments.statsPath.empty() && (statsFile = std::fopen(segments.statsPath.c_str(), "w")) == NULL) {
+			cerr << segments.statsPath << ": cannot be written" << endl;
+			return 0;
+		}
+		std::unique_ptr<IntervalStatistics> intervals;
+		if (segments.statsInterval > 0) intervals.reset(new IntervalStatistics(statsFile, segments.statsJson, simulator.memory));
+
+		bool traceOk;
+		if (pipelined) {
+			traceOk = isBinaryTrace(fileString)
+			        ? simulateFileInSegments< PipelinedReader<BinaryTraceReader> >(simulator, config, fileString, segments, intervals.get())
+			        : simulateFileInSegments< PipelinedReader<TraceReader> >(simulator, config, fileString, segments, intervals.get());
+		} else {
+			traceOk = isBinaryTrace(fileString)
+			        ? simulateFileInSegments<BinaryTraceReader>(simulator, config, fileString, segments, intervals.get())
+			        : simulateFileInSegments<TraceReader>(simulator, config, fileString, segments, intervals.get());
+		}
+		if (statsFile != stderr) std::fclose(statsFile);
+		if (traceOk) {
+			printStatistics(simulator.statistics());
+		}
+		return 0;
+	}
+
+	if (threadsNum > 1 && ShardedMemory::maxShardBits(config) > 0 && config.isShardable()) {
+		// a few shards per thread, to even out sets that are busier than others. the merged
+		// statistics are the very same as those of a serial run
+		unsigned long int shardBits = 0;
+		while ((1ul << shardBits) < 4ul * threadsNum) ++shardBits;
+		ShardedMemory sharded(config, std::min(shardBits, ShardedMemory::maxShardBits(config)));
+		bool traceOk = isBinaryTrace(fileString) ? simulateFileSharded<BinaryTraceReader>(sharded, fileString, threadsNum)
+		                                         : simulateFileSharded<TraceReader>(sharded, fileString, threadsNum);
+		if (traceOk) {
+			printStatistics(statisticsOf(sharded.merge()));
+		}
+		return 0;
+	}
+
+	/* initialize the Memory Data-Type: 2 level cache and main */
+	Simulator simulator(config);
+	bool traceOk;
+	if (pipelined) {
+		// the trace is read and decoded on a thread of its own, ahead of the simulation
+		traceOk = isBinaryTrace(fileString) ? simulateFile< PipelinedReader<BinaryTraceReader> >(simulator, fileString)
+		                                    : simulateFile< PipelinedReader<TraceReader> >(simulator, fileString);
+	} else {
+		traceOk = isBinaryTrace(fileString) ? simulateFile<BinaryTraceReader>(simulator, fileString)
+		                                    : simulateFile<TraceReader>(simulator, fileString);
+	}
+	if (!traceOk) {
+		return 0;
+	}
 
-	printf("L1miss=%.03f ", L1MissRate);
-	printf("L2miss=%.03f ", L2MissRate);
-	printf("AccTimeAvg=%.03f\n", avgAccTime);
+	printStatistics(simulator.statistics());
 
 	return 0;
 }
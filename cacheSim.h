@@ -2,10 +2,15 @@
 #define CACHE_SIM_H_
 
 #include <vector>
-#include <cmath>
 #include <cassert>
 #include <algorithm>
 #include <string>
+#include <cstdint>
+#include <cstdlib>
+#include "tagMatch.h"
+#include "replacement.h"
+#include "prefetcher.h"
+#include "timing.h"
 
 static const char READ = 'r';
 static const char WRITE = 'w';
@@ -13,150 +18,534 @@ static const bool DIRTY = true;
 static const bool NOT_DIRTY = false;
 static const bool NO_WRITE_ALLOCATE = false;
 static const bool WRITE_ALLOCATE = true;
-static const int LEAST_RECENTLY_USED = 0;
+static const unsigned int NO_SLOT = ~0u;
+static const std::uint64_t INVALID_TAG = ~std::uint64_t(0);
+// inclusion policies of a cache-level towards the levels above it
+static const int INCLUSIVE = 0;     // holds every block of the levels above (evicting back-invalidates them)
+static const int NINE = 1;          // non-inclusive non-exclusive: no back-invalidation
+static const int EXCLUSIVE = 2;     // holds only the victims of the level above (blocks move up on a hit)
+
+
+/*      the address-decode plan of a cache-level: computed once from its geometry,
+        so splitting an address into (set,tag) costs two shifts and two ANDs           */
+//======================================================================================
+struct DecodePlan{
+    std::uint64_t setShift;
+    std::uint64_t setMask;
+    std::uint64_t tagShift;
+    std::uint64_t tagMask;
+    unsigned long int waysNum;
+//--------------------------------------------------------------------------------------
+    DecodePlan(unsigned long int blockBits, unsigned long int setBits, unsigned long int wayBits) :
+            setShift(blockBits), setMask( (std::uint64_t(1) << setBits) - 1 ),
+            tagShift(blockBits+setBits), tagMask( ~std::uint64_t(0) >> (blockBits+setBits) ),
+            waysNum( 1ul << wayBits ){
+        assert( blockBits+setBits < 64 );
+    }
+
+    unsigned long int setIndex(unsigned long int address) const{ return (address >> setShift) & setMask; }
+    unsigned long int tag(unsigned long int address) const{ return (address >> tagShift) & tagMask; }
+    unsigned long int ways() const{ return waysNum; }
+
+    // rebuilds the (block-aligned) address of a block out of its (tag,set) pair
+    unsigned long int blockAddress(unsigned long int tag, unsigned long int setIndex) const{
+        return (tag << tagShift) | (setIndex << setShift);
+    }
+};
+
+
 
+/*      a DecodePlan whose geometry is fixed at compile-time, for the geometries that
+        get their own specialized access path (see NIGHTLY_GEOMETRIES in simulator.cpp)   */
+//======================================================================================
+template<unsigned int blockBits, unsigned int setBits, unsigned int wayBits>
+struct FixedDecodePlan{
+    static unsigned long int setIndex(unsigned long int address){
+        return (address >> blockBits) & ( (std::uint64_t(1) << setBits) - 1 );
+    }
+    static unsigned long int tag(unsigned long int address){
+        return (address >> (blockBits+setBits)) & ( ~std::uint64_t(0) >> (blockBits+setBits) );
+    }
+    static unsigned long int ways(){ return 1ul << wayBits; }
 
-/*      helper function for extracting decimal-integers 
-                out of boulian-representation.                         */
-//======================================================================
-unsigned long int bitExtracted(unsigned long int number, int k, int p){
-    return  (((1 << k) - 1) & (number >> (p - 1))) ;
-}
+    // checks if a cache-level that runs with the (runtime) plan has this geometry
+    static bool matches(const DecodePlan& plan){
+        return plan.setShift==blockBits && plan.tagShift==blockBits+setBits && plan.waysNum==ways();
+    }
+};
 
 
 
-/*     Auxiliary struct for representing a block from the main-Memory,
-        that should be (or already) stored inside the cache-Memory          */
+/*      Auxiliary struct for locating a block inside a highly-associative cache-level
+        without scanning its whole set: an open-addressing hash table that maps the
+        (tag,set) pair of every valid block into its position in the cache            */
 //====================================================================================
-struct Block{
-// block's data-------------------
-    bool valid;
-    bool dirtyBit;
-    unsigned long int tag; 
-    unsigned long int data;
-    unsigned long int statusLRU; 
+struct WayIndex{
+// table's data-------------------
+    std::vector<unsigned long int> keys;
+    std::vector<unsigned int> slots;
+    unsigned long int mask;
 // ------------------------------------------------------------------------------------
-    explicit Block(bool valid=false, bool dirtyBit=NOT_DIRTY , unsigned long int tag=0,
-                    unsigned long int data=0, unsigned long int statusLRU=0 ):
-                    valid(valid), dirtyBit(dirtyBit), tag(tag), data(data){}
-//--------------------------------------------------------------------------------------
+    explicit WayIndex(unsigned long int blocksNum=0) : mask(0){
+        unsigned long int capacity = 1;
+        while( capacity < 2*blocksNum ) capacity <<= 1;
+        if( blocksNum==0 ) return;
+        keys.assign(capacity, 0);
+        slots.assign(capacity, NO_SLOT);
+        mask = capacity-1;
+    }
+
+    unsigned long int home(unsigned long int key) const{
+        return (key * 0x9E3779B97F4A7C15ull) >> 17 & mask;
+    }
+
+    // gets the position of the block with this key, or NO_SLOT if it is not cached
+    unsigned int find(unsigned long int key) const{
+        for( unsigned long int i=home(key) ; slots[i]!=NO_SLOT ; i=(i+1)&mask ){
+            if( keys[i]==key ) return slots[i];
+        }
+        return NO_SLOT;
+    }
+
+    void insert(unsigned long int key, unsigned int slot){
+        unsigned long int i = home(key);
+        while( slots[i]!=NO_SLOT ) i = (i+1)&mask;
+        keys[i] = key;
+        slots[i] = slot;
+    }
+
+    // removes the key by shifting back the rest of its probe-chain (no tombstones)
+    void erase(unsigned long int key){
+        unsigned long int i = home(key);
+        while( slots[i]!=NO_SLOT && keys[i]!=key ) i = (i+1)&mask;
+        assert( slots[i]!=NO_SLOT );
+        for( unsigned long int j=(i+1)&mask ; slots[j]!=NO_SLOT ; j=(j+1)&mask ){
+            unsigned long int h = home(keys[j]);
+            // the entry at j may fill the hole at i only if its home is not in (i,j]
+            if( ((j-h)&mask) >= ((j-i)&mask) ){
+                keys[i] = keys[j];
+                slots[i] = slots[j];
+                i = j;
+            }
+        }
+        slots[i] = NO_SLOT;
+    }
 };
 
 
+// sets with more ways than this are located through a WayIndex rather than by scanning
+static const unsigned long int INDEXED_WAYS_THRESHOLD = 32;
+
+
 
 
 
 /*                      Auxiliary struct for representing a layer of the cache-Memory,
-                                        i.e L1-cache or L2-cache                                                 */
+                                        i.e L1-cache or L2-cache.
+        the blocks are stored as flat structure-of-arrays indexed by slot = set*totalWaysNum+way:
+        one contiguous tag array (each set's tags are packed next to each other) and separate
+        valid/dirty bitmaps, so probing a set touches only its tags                               */
 //===============================================================================================================
 struct Cache{
-// Cache's data---------------------------
-    std::vector< std::vector<Block> > sets;
-    std::vector<int> lruPolicy;
+// Cache's geometry-----------------------
     const unsigned long int layerSize;  
     const unsigned long int blockSize;
     const unsigned long int cyclesNum;
     const unsigned long int totalWaysNum;
+    const unsigned long int setsNum;
+    const DecodePlan plan;
+// Cache's policies-----------------------
+    const bool writePolicy;
+    const int inclusion;
+// Cache's data---------------------------
+    std::vector<std::uint64_t> tags;
+    std::vector<std::uint64_t> validBits;
+    std::vector<std::uint64_t> dirtyBits;
+    std::vector<unsigned int> occupiedWays;
+    std::vector<unsigned int> freeHint;         // of every set: all of its ways below it are valid
+    Replacement replacement;
+    WayIndex wayIndex;
+    const bool indexed;
+    TagMatchKernel matchTag;
+    std::vector<std::uint64_t> prefetchedBits;  // blocks that were prefetched and not asked for yet
+    std::vector<double> readyAt;                // the time at which a prefetched block arrives (see Memory::clock)
 // for statistics:------------------------
-    int missNum;
-    int acssesNum;
+    unsigned long int missNum;
+    unsigned long int acssesNum;
+    unsigned long int prefetchIssued;
+    unsigned long int prefetchUseful;       // asked for after they arrived
+    unsigned long int prefetchLate;         // asked for before they arrived
+    unsigned long int prefetchPolluting;    // evicted without being asked for
+    unsigned long int evictionsNum;
+    unsigned long int writeBacksNum;        // evictions of dirty blocks
+    unsigned long int backInvalidationsNum; // blocks dropped since an inclusive level below evicted them
+    std::vector<unsigned int> setEvictions; // of every set - only while the interval statistics are on
 // -------------------------------------------------------------------------------------------------------------------
-    Cache(unsigned long associativity, unsigned long layerSize, unsigned long blockSize, unsigned long cyclesNum) :
-            sets(  pow(2,layerSize-blockSize-associativity), std::vector<Block>( pow(2,associativity),Block() )  ),
-            lruPolicy( sets.size() , 0 ), layerSize(layerSize),blockSize(blockSize),
-            cyclesNum(cyclesNum),totalWaysNum( sets[0].size() ),missNum(0),acssesNum(0){
+    Cache(unsigned long associativity, unsigned long layerSize, unsigned long blockSize, unsigned long cyclesNum,
+          bool writePolicy=WRITE_ALLOCATE, int inclusion=INCLUSIVE, int replacementPolicy=LRU, std::uint64_t seed=1) :
+            layerSize(layerSize),blockSize(blockSize),cyclesNum(cyclesNum),
+            totalWaysNum( 1ul << associativity ),setsNum( 1ul << (layerSize-blockSize-associativity) ),
+            plan( blockSize , layerSize-blockSize-associativity , associativity ),
+            writePolicy(writePolicy),inclusion(inclusion),
+            tags( setsNum*totalWaysNum, INVALID_TAG ),validBits( bitmapWords() , 0 ),dirtyBits( bitmapWords() , 0 ),
+            occupiedWays( setsNum , 0 ),freeHint( setsNum , 0 ),replacement( replacementPolicy , setsNum , totalWaysNum , seed ),
+            indexed( totalWaysNum>INDEXED_WAYS_THRESHOLD ),matchTag( bestTagMatchKernel(totalWaysNum) ),
+            missNum(0),acssesNum(0),prefetchIssued(0),prefetchUseful(0),prefetchLate(0),prefetchPolluting(0),
+            evictionsNum(0),writeBacksNum(0),backInvalidationsNum(0){
+        if( indexed ) wayIndex = WayIndex( setsNum*totalWaysNum );
     }
 
-    // gets the set in which the address is mapped to
-    std::vector<Block>& getSet(unsigned long int address){
-        int waysBits = log2(totalWaysNum);
-        int setBits = layerSize-blockSize-waysBits;
-        int index = bitExtracted(address,setBits,blockSize+1);
+    // keeps track of the prefetched blocks (only levels with a prefetcher do)
+    void trackPrefetches(){
+        prefetchedBits.assign( bitmapWords() , 0 );
+        readyAt.assign( setsNum*totalWaysNum , 0 );
+    }
 
-        return sets[index];
+    unsigned long int bitmapWords() const{
+        return (setsNum*totalWaysNum + 63) / 64;
+    }
+
+    // counts from the next access on
+    void resetStatistics(){
+        missNum = 0;
+        acssesNum = 0;
+        prefetchIssued = 0;
+        prefetchUseful = 0;
+        prefetchLate = 0;
+        prefetchPolluting = 0;
+        evictionsNum = 0;
+        writeBacksNum = 0;
+        backInvalidationsNum = 0;
+        setEvictions.assign( setEvictions.size() , 0 );
+    }
+
+    // saves or loads the level's blocks, replacement state and statistics (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        archive.array(tags);
+        archive.array(validBits);
+        archive.array(dirtyBits);
+        archive.array(occupiedWays);
+        freeHint.assign( setsNum , 0 ); // a hint of 0 holds for any blocks - and is not saved
+        replacement.checkpoint(archive);
+        archive.array(wayIndex.keys);
+        archive.array(wayIndex.slots);
+        archive.array(prefetchedBits);
+        archive.array(readyAt);
+        archive.value(missNum);
+        archive.value(acssesNum);
+        archive.value(prefetchIssued);
+        archive.value(prefetchUseful);
+        archive.value(prefetchLate);
+        archive.value(prefetchPolluting);
+        archive.value(evictionsNum);
+        archive.value(writeBacksNum);
+        archive.value(backInvalidationsNum);
+    }
+
+    // gets the index of the set in which the address is mapped to
+    unsigned long int getSetIndex(unsigned long int address) const{
+        return plan.setIndex(address);
     }
 
 
     // gets the tag of the address in this level-cache's point of view
-    unsigned long int getTag(unsigned long int address){
-        int waysBits = log2(totalWaysNum);
-        int bitsNum = 32-(layerSize-waysBits+1);
+    unsigned long int getTag(unsigned long int address) const{
+        return plan.tag(address);
+    }
+
+
+    // rebuilds the (block-aligned) address of the block that is stored in the slot
+    unsigned long int addressOf(unsigned int slot) const{
+        return plan.blockAddress( tags[slot] , slot/totalWaysNum );
+    }
+
 
-        return bitExtracted(address,bitsNum,layerSize-waysBits+1);
+    // key of a block inside the WayIndex: the (tag,set) pair of the address
+    unsigned long int indexKey(unsigned long int tag, unsigned long int setIndex) const{
+        return tag*setsNum + setIndex;
     }
 
 
-    // gets the memory-block in which address is part of it
-    std::vector<Block>::iterator getBlock(unsigned long int address){
-        std::vector<Block>& set = getSet(address);
-        unsigned long int tag = getTag(address);
+    // slot-level accessors for the valid/dirty bitmaps
+    bool isValid(unsigned int slot) const{ return (validBits[slot/64] >> (slot%64)) & 1; }
+    bool isDirty(unsigned int slot) const{ return (dirtyBits[slot/64] >> (slot%64)) & 1; }
+    void markDirty(unsigned int slot){ dirtyBits[slot/64] |= std::uint64_t(1) << (slot%64); }
+    void clearDirty(unsigned int slot){ dirtyBits[slot/64] &= ~(std::uint64_t(1) << (slot%64)); }
+    bool isPrefetched(unsigned int slot) const{
+        return !prefetchedBits.empty() && ((prefetchedBits[slot/64] >> (slot%64)) & 1);
+    }
+    void markPrefetched(unsigned int slot, double arrival){
+        prefetchedBits[slot/64] |= std::uint64_t(1) << (slot%64);
+        readyAt[slot] = arrival;
+    }
+    void clearPrefetched(unsigned int slot){ prefetchedBits[slot/64] &= ~(std::uint64_t(1) << (slot%64)); }
 
-        std::vector<Block>::iterator block;
-        for( block = set.begin() ; block!=set.end() ; block++){
-            if(  (block->valid==true) && (block->tag==tag)  ){
-                break;
-            }
+    // moves the arrivals of the prefetched blocks 'time' back, as the clock that they are stamped by
+    // restarts from 0 when it was at 'time'
+    void shiftArrivals(double time){
+        for( std::size_t slot=0 ; slot<readyAt.size() ; ++slot ) readyAt[slot] -= time;
+    }
+
+    // a prefetched block leaves the level without being asked for
+    void dropPrefetched(unsigned int slot){
+        if( !isPrefetched(slot) ) return;
+        clearPrefetched(slot);
+        ++prefetchPolluting;
+    }
+
+
+    // gets the slot of the memory-block in which address is part of it (NO_SLOT if not cached).
+    // Plan is this level's DecodePlan, or a FixedDecodePlan of the very same geometry
+    template<class Plan>
+    unsigned int probe(const Plan& decode, unsigned long int address) const{
+        unsigned long int index = decode.setIndex(address);
+        unsigned long int tag = decode.tag(address);
+        unsigned long int ways = decode.ways();
+
+        if( indexed ){
+            return wayIndex.find( indexKey(tag,index) );
+        }
+        // invalid ways hold INVALID_TAG, which no address maps to
+        const std::uint64_t* set = &tags[index*ways];
+        unsigned long int way;
+        if( ways<VECTOR_MATCH_MIN_WAYS ){
+            for( way=0 ; way<ways && set[way]!=tag ; ++way );
+        }else{
+            way = matchTag(set,ways,tag);
         }
-        return block;
+        return (way==ways) ? NO_SLOT : index*ways + way;
+    }
+
+
+    unsigned int getBlock(unsigned long int address) const{
+        return probe(plan,address);
     }
 
 
+    // checks if the set in which the address is mapped to has no free way
+    bool isSetFull(unsigned long int address){
+        return occupiedWays[ getSetIndex(address) ] == totalWaysNum;
+    }
 
 
     //finds the free-way in the relevant set for this cache-layer. (assums THERE IS a free way)
-    std::vector<Block>::iterator freeWayFor(unsigned long int address){
-        int index= bitExtracted(address,layerSize-blockSize-log2(totalWaysNum),blockSize+1);
-        std::vector<Block>::iterator i;
-        for( i=sets[index].begin() ; i!=sets[index].end(); i++){
-            if ( i->valid==false ){
+    //it is the lowest one: the scan starts at the set's hint, so a filling set is not scanned over and over
+    unsigned int freeWayFor(unsigned long int address){
+        unsigned long int index = getSetIndex(address);
+        unsigned long int slot = index*totalWaysNum + freeHint[index];
+        unsigned long int end = index*totalWaysNum + totalWaysNum;
+        while( slot<end ){
+            std::uint64_t freeBits = ~validBits[slot/64] >> (slot%64);
+            if( freeBits!=0 ){
+                slot += __builtin_ctzll(freeBits);
                 break;
             }
+            slot = (slot|63) + 1;
         }
-        assert( i!=sets[index].end() );
-        return i;
+        assert( slot<end );
+        freeHint[index] = slot - index*totalWaysNum;
+        return slot;
     }
 
 
-    //finds the least-recently-used way in the relevant set for this cache-level. (assums THERE IS a free way)
-    std::vector<Block>::iterator leastRecentlyUsed(unsigned long int address){
-        int index= bitExtracted(address,layerSize-blockSize-log2(totalWaysNum),blockSize+1);
-        std::vector<Block>::iterator it = sets[index].begin();
-        assert( it->valid==true );
-        return it;
+    //finds the way to evict in the relevant set for this cache-level, by its replacement policy
+    //(the least-recently-used one under LRU). (assums the set is full)
+    unsigned int victimFor(unsigned long int address){
+        unsigned long int index = getSetIndex(address);
+        unsigned int slot = index*totalWaysNum + replacement.victim(index);
+        assert( isValid(slot) );
+        return slot;
     }
 
 
     // checks if this cache-level is currently holding the address's block
-    bool containsBlockOf(unsigned long int address){
-        std::vector<Block>& set = getSet(address);
-        unsigned long int tag = getTag(address);
-
-        std::vector<Block>::iterator block;
-        for( block = set.begin() ; block!=set.end() ; block++){
-            if(  (block->valid==true) && (block->tag==tag)  ){
-                return true;
-            }
+    bool containsBlockOf(unsigned long int address) const{
+        return getBlock(address) != NO_SLOT;
+    }
+
+
+    // stores the address's block in the given slot (which must be free or just evicted),
+    // as the replacement policy inserts a new block. returns the slot
+    unsigned int place(unsigned int slot, unsigned long int address){
+        unsigned long int index = getSetIndex(address);
+        if( isValid(slot) ){
+            if( indexed ) wayIndex.erase( indexKey(tags[slot],index) );
+            dropPrefetched(slot);
+        }else{
+            validBits[slot/64] |= std::uint64_t(1) << (slot%64);
+            ++occupiedWays[index];
         }
-        return false;
+        tags[slot] = getTag(address);
+        if( indexed ) wayIndex.insert( indexKey(tags[slot],index), slot );
+        replacement.insert( index, slot%totalWaysNum );
+        return slot;
     }
 
 
-    // method for managing the policy of Blocks-evacuation from the cache
-    std::vector<Block>::iterator updateLRU(int address){
-        int i = bitExtracted(address,layerSize-blockSize-log2(totalWaysNum),blockSize+1);
+    // drops the block out of the cache (the way becomes free)
+    void invalidate(unsigned int slot){
+        assert( isValid(slot) );
+        unsigned long int index = slot / totalWaysNum;
+        if( indexed ) wayIndex.erase( indexKey(tags[slot],index) );
+        dropPrefetched(slot);
+        tags[slot] = INVALID_TAG;
+        validBits[slot/64] &= ~(std::uint64_t(1) << (slot%64));
+        clearDirty(slot);
+        --occupiedWays[index];
+        freeHint[index] = std::min<unsigned int>( freeHint[index] , slot%totalWaysNum );
+    }
+
+
+    // marks the block in the slot as accessed (the most-recently-used one of its set, under LRU)
+    unsigned int touch(unsigned int slot){
+        replacement.touch( slot/totalWaysNum, slot%totalWaysNum );
+        return slot;
+    }
+};
+
+
+
+
+
+
+/*      the configuration of a single cache-level (size is log2 of bytes, associativity is log2 of ways)    */
+//=========================================================================================================
+struct LevelConfig{
+    unsigned long int size;
+    unsigned long int assoc;
+    unsigned long int cyc;
+    int writeAllocate;      // as the memory's --wr-alloc when negative
+    int inclusion;
+    int replacement;
+    int prefetcher;
+    unsigned long int prefetchDegree;
+    unsigned long int mshrs;            // for the timing model
+//-------------------------------------------------------------------------------------------------------
+    LevelConfig() : size(0),assoc(0),cyc(0),writeAllocate(-1),inclusion(INCLUSIVE),replacement(LRU),
+                    prefetcher(NO_PREFETCH),prefetchDegree(2),mshrs(8){
+    }
+};
+
+
+// the deepest level that the "--l<n>-..." flags may configure
+static const unsigned long int MAX_LEVELS = 8;
 
-        class compareLRU{
-        // Functor for comparing Blocks
-        // based on LRU-policy-status
-        public:
-            inline bool operator()(const Block& b1,const Block& b2)const{
-                return (b1.statusLRU < b2.statusLRU) ;
-            }
-        };
 
-        getBlock(address)->statusLRU = ++lruPolicy[i];
-        std::sort( sets[i].begin(), sets[i].end(), compareLRU() );
-        return getBlock(address);
+
+/*      the configuration of the whole memory structure, as given by the command-line flags:
+        "--l<n>-size/assoc/cyc/wr-alloc/inclusion/repl/prefetch/prefetch-degree" configure level n
+        (L1 is the closest to the cpu) - a two-level hierarchy by default, that grows by the deepest
+        level that is mentioned.
+        "--seed" seeds the randomized replacement policies. "--timing 1" adds the timing model, with
+        "--l<n>-mshrs", "--mem-bw" (bytes per cycle, 0 for unlimited) and "--wb-buffer" (entries)     */
+//=========================================================================================================
+struct MemoryConfig{
+    unsigned long int memCyc;
+    unsigned long int blockSize;
+    bool writeAllocate;
+    unsigned long int seed;
+    bool timing;
+    unsigned long int memBandwidth;
+    unsigned long int writeBufferSize;
+    std::vector<LevelConfig> levels;
+//-------------------------------------------------------------------------------------------------------
+    MemoryConfig() : memCyc(0),blockSize(0),writeAllocate(NO_WRITE_ALLOCATE),seed(1),
+                     timing(false),memBandwidth(16),writeBufferSize(8),levels(2){
+    }
+
+    // sets the field of a command-line flag (e.g "--l1-size"). returns false for an unknown flag
+    bool set(const std::string& flag, unsigned long int value){
+        if( flag=="--mem-cyc" )          memCyc = value;
+        else if( flag=="--bsize" )       blockSize = value;
+        else if( flag=="--wr-alloc" )    writeAllocate = (value!=0);
+        else if( flag=="--seed" )        seed = value;
+        else if( flag=="--timing" )      timing = (value!=0);
+        else if( flag=="--mem-bw" )      memBandwidth = value;
+        else if( flag=="--wb-buffer" )   writeBufferSize = value;
+        else{
+            // "--l<n>-<field>"
+            char* field;
+            if( flag.compare(0,3,"--l")!=0 ) return false;
+            unsigned long int level = std::strtoul(flag.c_str()+3, &field, 10);
+            if( field==flag.c_str()+3 || level<1 || level>MAX_LEVELS ) return false;
+            LevelConfig parsed = (level<=levels.size()) ? levels[level-1] : LevelConfig();
+            std::string name(field);
+            if( name=="-size" )              parsed.size = value;
+            else if( name=="-assoc" )        parsed.assoc = value;
+            else if( name=="-cyc" )          parsed.cyc = value;
+            else if( name=="-wr-alloc" )     parsed.writeAllocate = (value!=0);
+            else if( name=="-inclusion" )    parsed.inclusion = (int)value;
+            else if( name=="-repl" )         parsed.replacement = (int)value;
+            else if( name=="-prefetch" )     parsed.prefetcher = (int)value;
+            else if( name=="-prefetch-degree" ) parsed.prefetchDegree = value;
+            else if( name=="-mshrs" )        parsed.mshrs = value;
+            else return false;
+            if( level>levels.size() ) levels.resize(level);
+            levels[level-1] = parsed;
+        }
+        return true;
+    }
+
+    // saves or loads the configuration (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        archive.value(memCyc);
+        archive.value(blockSize);
+        archive.value(writeAllocate);
+        archive.value(seed);
+        archive.value(timing);
+        archive.value(memBandwidth);
+        archive.value(writeBufferSize);
+        archive.array(levels);
+    }
+
+    // checks if both configurations build the same memory
+    bool sameAs(const MemoryConfig& other) const{
+        if( memCyc!=other.memCyc || blockSize!=other.blockSize || writeAllocate!=other.writeAllocate ||
+            seed!=other.seed || timing!=other.timing || memBandwidth!=other.memBandwidth ||
+            writeBufferSize!=other.writeBufferSize || levels.size()!=other.levels.size() ) return false;
+        for( std::size_t i=0 ; i<levels.size() ; ++i ){
+            const LevelConfig& level = levels[i];
+            const LevelConfig& otherLevel = other.levels[i];
+            if( level.size!=otherLevel.size || level.assoc!=otherLevel.assoc || level.cyc!=otherLevel.cyc ||
+                level.writeAllocate!=otherLevel.writeAllocate || level.inclusion!=otherLevel.inclusion ||
+                level.replacement!=otherLevel.replacement || level.prefetcher!=otherLevel.prefetcher ||
+                level.prefetchDegree!=otherLevel.prefetchDegree || level.mshrs!=otherLevel.mshrs ) return false;
+        }
+        return true;
+    }
+
+    // the write policy of a level: its own, or else the memory's
+    bool writePolicyOf(std::size_t level) const{
+        return (levels[level].writeAllocate<0) ? writeAllocate : (levels[level].writeAllocate!=0);
+    }
+
+    // checks that every level holds at least one set of whole blocks, with known policies
+    bool isValid() const{
+        for( std::size_t i=0 ; i<levels.size() ; ++i ){
+            const LevelConfig& level = levels[i];
+            if( level.size<blockSize+level.assoc || level.size-blockSize>=32 ) return false;
+            if( level.inclusion<INCLUSIVE || level.inclusion>EXCLUSIVE ) return false;
+            if( level.replacement<0 || level.replacement>=POLICIES_NUM ) return false;
+            if( level.prefetcher<0 || level.prefetcher>=PREFETCHERS_NUM ) return false;
+            if( level.prefetchDegree<1 || level.prefetchDegree>MAX_PREFETCH_DEGREE ) return false;
+            if( timing && level.mshrs<1 ) return false;
+        }
+        return !timing || writeBufferSize>=1;
+    }
+
+    // checks if the sets of every level may be simulated apart (see ShardedMemory): not when
+    // a level replaces blocks by random draws, that go in the order of the whole trace, nor when
+    // it prefetches - the blocks that it prefetches fall in other sets - nor under the timing
+    // model, whose MSHRs and memory channel are shared by all the sets
+    bool isShardable() const{
+        if( timing ) return false;
+        for( std::size_t i=0 ; i<levels.size() ; ++i ){
+            if( levels[i].replacement==BRRIP || levels[i].replacement==RANDOM ) return false;
+            if( levels[i].prefetcher!=NO_PREFETCH ) return false;
+        }
+        return true;
     }
 };
 
@@ -166,211 +555,358 @@ struct Cache{
 
 
 /*                     THE data-type for representing the whole memory structure.
-                                this struct is the type that main calls                                    */
+                                this struct is the type that main calls.
+        an access probes the levels from L1 down until one hits (or the main memory is reached), and
+        then the block is fetched up, level by level, into the levels above the one that held it     */
 //=========================================================================================================
 struct Memory{
-// Memory's cache levels:
-    Cache L1;
-    Cache L2;
+// Memory's cache levels (levels[0] is L1):
+    std::vector<Cache> levels;
+    std::vector<Prefetcher> prefetchers;    // of every level
+    bool prefetching;                       // some level has a prefetcher
+    TimingModel timing;
+    bool timed;                             // the timing model is on
 // Memory's mete_data-------------------------------
-    bool writePolicy;
     unsigned long int blockSize; // log2(blockSize)
     unsigned long int cyclesNum;
 // for statistics-----------------------------------
     double totalTime;
     double acessNum;
 //-------------------------------------------------------------------------------------------------------
-    Memory(unsigned long int associativity1, unsigned long int Size1, unsigned long int cyclesNum1,
-          unsigned long int associativity2, unsigned long int Size2, unsigned long int cyclesNum2,
-          bool writePolicy, unsigned long int blockSize, unsigned long int cyclesNum3):
-          L1(associativity1, Size1, blockSize,cyclesNum1), L2(associativity2, Size2, blockSize,cyclesNum2),
-          writePolicy(writePolicy),blockSize(blockSize),cyclesNum(cyclesNum3), totalTime(0),acessNum(0){
+    explicit Memory(const MemoryConfig& config):
+          prefetching(false),timed(config.timing),blockSize(config.blockSize),cyclesNum(config.memCyc),
+          totalTime(0),acessNum(0){
+        assert( config.levels.size()>=2 );
+        levels.reserve( config.levels.size() );
+        for( std::size_t i=0 ; i<config.levels.size() ; ++i ){
+            const LevelConfig& level = config.levels[i];
+            levels.push_back( Cache(level.assoc, level.size, blockSize, level.cyc, config.writePolicyOf(i), level.inclusion,
+                                    level.replacement, config.seed + i) );
+            prefetchers.push_back( Prefetcher(level.prefetcher, level.prefetchDegree) );
+            if( level.prefetcher!=NO_PREFETCH ){
+                levels.back().trackPrefetches();
+                prefetching = true;
+            }
+        }
+        if( timed ){
+            std::vector<unsigned long int> mshrs;
+            std::vector<double> cycles;
+            for( std::size_t i=0 ; i<config.levels.size() ; ++i ){
+                mshrs.push_back( config.levels[i].mshrs );
+                cycles.push_back( config.levels[i].cyc );
+            }
+            timing = TimingModel(mshrs, cycles, cyclesNum, 1ul << blockSize, config.memBandwidth, config.writeBufferSize);
+        }
     }
 
 
 
-    // vacates a block with address - due to Li (where i=1 OR i=2 ) got Miss for capacity or compulsary
-    void evacuateFrom(Cache& Li,unsigned long int address){
-        assert( Li.getSet(address)[LEAST_RECENTLY_USED].valid );
-        unsigned long int evictedAddress = Li.getSet(address)[LEAST_RECENTLY_USED].data;
-        bool& bit = Li.getSet(address)[LEAST_RECENTLY_USED].dirtyBit;
+    // counts from the next access on: the accesses so far only warmed the memory up
+    void resetStatistics(){
+        for( std::size_t i=0 ; i<levels.size() ; ++i ){
+            levels[i].resetStatistics();
+            // the prefetches on their way still arrive on time (the timing model's clock goes on)
+            if( !timed ) levels[i].shiftArrivals(totalTime);
+        }
+        if( timed ) timing.resetStatistics();
+        totalTime = 0;
+        acessNum = 0;
+    }
+
 
-        if( bit==DIRTY  &&  &Li==&L1 ){
-            L2.updateLRU( evictedAddress )->dirtyBit=DIRTY; // write L2
+    // saves or loads the whole state of the memory (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        for( std::size_t i=0 ; i<levels.size() ; ++i ){
+            levels[i].checkpoint(archive);
+            prefetchers[i].checkpoint(archive);
         }
-        bit = NOT_DIRTY;            
+        timing.checkpoint(archive);
+        archive.value(totalTime);
+        archive.value(acessNum);
     }
 
 
 
-    // writes a block to a non-full-set in cache (assumes that Level_1 got miss)
-    std::vector<Block>::iterator putInFreeWay(unsigned long int address){
-        Cache* targetCache;
-        std::vector<Block>::iterator free;
-        unsigned long int tag;
-        
-        if( (L1.containsBlockOf(address)==false) && (L2.containsBlockOf(address)) ){
-            targetCache = &L1;
-            free = L1.freeWayFor(address);
-            tag = L1.getTag(address);
-            L2.updateLRU(address); // read-request sent to L2
-        }
-        else{ assert( (L1.containsBlockOf(address)==false) && (L2.containsBlockOf(address)==false) );
-            targetCache = &L2;
-            free = L2.freeWayFor(address);
-            tag = L2.getTag(address);
-            // no-need for LRU-policy managing. read-request sent to Mem
+    // probes a level: L1/L2 with decode1/decode2, and the deeper levels with their own DecodePlan
+    template<class L1Plan, class L2Plan>
+    unsigned int probe(std::size_t level, unsigned long int address, const L1Plan& decode1, const L2Plan& decode2) const{
+        if( level==0 ) return levels[0].probe(decode1,address);
+        if( level==1 ) return levels[1].probe(decode2,address);
+        return levels[level].probe(levels[level].plan,address);
+    }
+
+
+
+    // the per-set eviction counts are kept (the interval statistics are on)
+    bool countsSetEvictions() const{
+        return !levels[0].setEvictions.empty();
+    }
+
+
+
+    // runs one access of the trace through the memory. L1/L2 are probed with decode1/decode2:
+    // their own DecodePlan, or a FixedDecodePlan of the very same geometry. countSets compiles the
+    // per-set eviction counts in, for the interval statistics (see countsSetEvictions)
+    template<bool countSets, class L1Plan, class L2Plan>
+    void access(unsigned long int address, char operation, const L1Plan& decode1, const L2Plan& decode2){
+        /* count the acsses to the memory */
+        ++acessNum;
+
+        std::size_t holder = 0;
+        unsigned int slot = NO_SLOT;
+        for( ; holder<levels.size() ; ++holder ){
+            Cache& level = levels[holder];
+            ++level.acssesNum;
+            totalTime += level.cyclesNum;
+            //--------------------------------------
+            slot = probe(holder,address,decode1,decode2);
+            if( slot!=NO_SLOT ) break;
+            ++level.missNum;
         }
-        assert( free->valid==false );
-        free->valid = true;
-        free->tag = tag;
-        free->data = address;
-        assert ( free->dirtyBit==NOT_DIRTY );
+        if( holder==levels.size() ) totalTime += cyclesNum; // <---- the main memory holds it
+
+        bool prefetchHit = prefetching && holder<levels.size() && levels[holder].isPrefetched(slot);
+        if( prefetchHit ) usePrefetched(holder,slot);
+
+        std::size_t top = fetch<countSets>(address,operation,holder,slot);
+        if( timed ) timing.complete(address >> blockSize, holder, top);
+        if( prefetching ) prefetchFor<countSets>(address,holder,prefetchHit);
+    }
+
 
-        targetCache->updateLRU(address); // <---- read target cache ( L1 or L2 )
-        return targetCache->getBlock(address);
+    void access(unsigned long int address, char operation){
+        if( countsSetEvictions() ) access<true>(address,operation,levels[0].plan,levels[1].plan);
+        else access<false>(address,operation,levels[0].plan,levels[1].plan);
     }
 
 
 
-    // writes a block to a full-set in the cache (assumes that Level_1 got miss)
-    std::vector<Block>::iterator evacuateAndPut(unsigned long int address){
-        Cache* targetCache;
-        std::vector<Block>::iterator evicted;
-        unsigned long int tag;
+    // brings the block up from the level that holds it in slot (levels.size() for the main memory).
+    // a read fills every level above it, while a write fills them only up to the highest one of
+    // the write-allocating levels right above the holder - and the write lands where the fill stops.
+    // returns the highest level that got the block (the holder, when none did)
+    template<bool countSets>
+    std::size_t fetch(unsigned long int address, char operation, std::size_t holder, unsigned int slot){
+        std::size_t top = 0;
+        if( operation==WRITE ){
+            for( top=holder ; top>0 && levels[top-1].writePolicy==WRITE_ALLOCATE ; --top );
+        }
 
-        // miss in L1 and hit in L2
-        if( (L1.containsBlockOf(address)==false) && (L2.containsBlockOf(address)) ){
-            targetCache = &L1;
-            evicted = L1.leastRecentlyUsed(address);
-            L2.updateLRU(address); //  <----- read L2
-            evacuateFrom(L1,address);
-            tag = L1.getTag(address);
+        if( top==holder ){
+            if( holder==levels.size() ){
+                // we "only" need to write the data into its address in the main memory
+                if( timed ) timing.writeToMemory();
+                return top;
+            }
+            levels[holder].touch(slot);
+            if( operation==WRITE ) levels[holder].markDirty(slot);
+            return top;
         }
-        // miss in L2 thus acsses Mem
-        else{ assert( (L1.containsBlockOf(address)==false) && (L2.containsBlockOf(address)==false) );
-            targetCache = &L2;
-            evicted = L2.leastRecentlyUsed(address);
-            evacuateFrom(L2,address);
-            tag = L2.getTag(address);
+
+        slot = fillUp<countSets>(address,holder,slot,top);
+        if( operation==WRITE ) levels[top].markDirty(slot);
+        return top;
+    }
+
+
+
+    // fills the block into the levels above its holder (that holds it in slot), up to 'top'.
+    // returns its slot in 'top'
+    template<bool countSets>
+    unsigned int fillUp(unsigned long int address, std::size_t holder, unsigned int slot, std::size_t top){
+        std::size_t source = holder;
+        for( std::size_t level=holder ; level-- > top ; ){
+            // an exclusive level is passed by, unless the fill ends in it
+            if( level>top && levels[level].inclusion==EXCLUSIVE ) continue;
+            slot = fill<countSets>(level,address,source,slot);
+            source = level;
         }
+        return slot;
+    }
 
-        assert( evicted->valid==true );
-        evicted->tag = tag;
-        evicted->data = address;
-        assert ( evicted->dirtyBit == NOT_DIRTY );
 
-        targetCache->updateLRU(address); // <----  R E A D  the target cache ( L1 or L2 )
-        return targetCache->getBlock(address);
+
+    // the time that the prefetched blocks arrive by: the timing model's, when it is on
+    // (and otherwise the serialized totalTime)
+    double clock() const{
+        return timed ? timing.now : totalTime;
     }
 
 
 
-    // acssessing the data in L1 cache
-    void L1_Hit(unsigned long address,char operation){
-       std::vector<Block>::iterator modified = L1.updateLRU(address);
-       modified->dirtyBit = (operation==WRITE) ? DIRTY :  modified->dirtyBit;
+    // a demand access asks for a block that was prefetched into the level: after it arrived,
+    // or while it is still on its way (and then waits for the rest of it - in the serialized
+    // totalTime, unless the timing model is on, which waits for the block's MSHR by itself)
+    void usePrefetched(std::size_t level, unsigned int slot){
+        Cache& Li = levels[level];
+        Li.clearPrefetched(slot);
+        double wait = Li.readyAt[slot] - clock();
+        if( wait>0 ){
+            ++Li.prefetchLate;
+            if( !timed ) totalTime += wait;
+        }
+        else{ ++Li.prefetchUseful;}
     }
 
 
 
-    // acssessing the data in L2 cache
-    void L2_Hit(unsigned long address,char operation){
-        std::vector<Block>& set = L1.getSet(address);
-        char missInL1 = operation;
-        unsigned int occupiedWaysNum = 0;
-        for( unsigned int i=0 ; i<set.size() ; ++i ) occupiedWaysNum = (set[i].valid) ? (occupiedWaysNum+1) : (occupiedWaysNum);
-        
-        if( WRITE==missInL1 ){
-                if(/*******************/ writePolicy==WRITE_ALLOCATE /*************/){//----->> read_Hit in L2
-                        if( occupiedWaysNum < L1.totalWaysNum ){
-                            putInFreeWay(address) -> dirtyBit=DIRTY;
-                            return;
-                        }
-                        else{ assert( occupiedWaysNum == L1.totalWaysNum );
-                            evacuateAndPut(address) -> dirtyBit=DIRTY;
-                            return;
-                        }
+    // lets the prefetchers of the levels that the access reached observe it, and issues
+    // the prefetches that they ask for
+    template<bool countSets>
+    void prefetchFor(unsigned long int address, std::size_t holder, bool prefetchHit){
+        std::int64_t block = address >> blockSize;
+        std::int64_t wanted[MAX_PREFETCH_DEGREE];
+        for( std::size_t level=0 ; level<=holder && level<levels.size() ; ++level ){
+            bool missed = level<holder || prefetchHit;
+            unsigned int count = prefetchers[level].observe(block,missed,wanted);
+            for( unsigned int k=0 ; k<count ; ++k ){
+                prefetch<countSets>(level, (unsigned long int)wanted[k] << blockSize);
+            }
+        }
+    }
 
-                }else{ /*********/assert( writePolicy==NO_WRITE_ALLOCATE );/*******///----->> write_Hit in L2
-                        L2.updateLRU(address) -> dirtyBit=DIRTY;
-                        return;
-                }
 
-        }else{ assert( READ==missInL1 );
-                if( occupiedWaysNum < L1.totalWaysNum ){
-                    putInFreeWay(address);
-                    return;
-                }
-                //else - no availible way
-                    evacuateAndPut(address);
-                    return;
+
+    // fetches a block into the level ahead of its demand, through the very same fill path.
+    // it arrives once the levels below (or the main memory) deliver it - as the timing model
+    // times it, when it is on
+    template<bool countSets>
+    void prefetch(std::size_t level, unsigned long int address){
+        if( levels[level].containsBlockOf(address) ) return;
+        double latency = 0;
+        std::size_t holder = level+1;
+        unsigned int slot = NO_SLOT;
+        for( ; holder<levels.size() ; ++holder ){
+            latency += levels[holder].cyclesNum;
+            slot = levels[holder].getBlock(address);
+            if( slot!=NO_SLOT ) break;
         }
+        if( holder==levels.size() ) latency += cyclesNum;
+        double arrival = timed ? timing.prefetch(address >> blockSize, level, holder) : totalTime+latency;
+
+        slot = fillUp<countSets>(address,holder,slot,level);
+        levels[level].markPrefetched(slot, arrival);
+        ++levels[level].prefetchIssued;
     }
-                
-            
 
-    // keeping coherent by asserting the evacuation of data from L1 when evicting from l2
-    void L2_snoops_L1(unsigned long int address){
-        unsigned long int evictedAddress_L2 = L2.getSet(address)[LEAST_RECENTLY_USED].data;
-        if( L1.containsBlockOf(evictedAddress_L2)==false ) return;
 
-        (*L1.getBlock(evictedAddress_L2)) = Block(); 
-        // if the data is dirty in L1     ===>>   "we assign" dirtyBit=DIRTY in cache-Level2
-        // when evicting its L2 block                          (but its meaningless)
+
+    // writes the block into 'level', out of the 'source' level that holds it in sourceSlot (or out of
+    // the main memory, when source is levels.size()). returns its slot in 'level'
+    template<bool countSets>
+    unsigned int fill(std::size_t level, unsigned long int address, std::size_t source, unsigned int sourceSlot){
+        Cache& target = levels[level];
+        // an exclusive level right below hands the block over (with its dirty-bit) instead of keeping it
+        bool handedOver = source==level+1 && source<levels.size() && levels[source].inclusion==EXCLUSIVE;
+        bool dirty = handedOver && levels[source].isDirty(sourceSlot);
+        unsigned int free;
+
+        if( target.isSetFull(address)==false ){ assert( target.containsBlockOf(address)==false );
+            free = target.freeWayFor(address);
+            release(source,sourceSlot,handedOver); // read-request sent to the source level
         }
-    
-
-
-    // acssessing the data in the main Memory, and fetching it into L2 cache
-    void handle_L2_Miss(unsigned long int address){
-        std::vector<Block>& set = L2.getSet(address);
-        unsigned int occupiedWaysNum = 0;
-        for( unsigned int i=0 ; i<set.size() ; ++i ) occupiedWaysNum = (set[i].valid) ? (occupiedWaysNum+1) : (occupiedWaysNum);
-        
-        if( occupiedWaysNum < L2.totalWaysNum ){
-            putInFreeWay(address);
-            return;
+        else{ assert( target.containsBlockOf(address)==false );
+            free = target.victimFor(address);
+            if( level>0 && target.inclusion==INCLUSIVE ) snoopUpperLevels(level, target.addressOf(free));
+            release(source,sourceSlot,handedOver); // <----- read the source level
+            evacuateFrom<countSets>(level,free);
         }
-        else{ assert( occupiedWaysNum == L2.totalWaysNum );
-            L2_snoops_L1(address);
-            evacuateAndPut(address);
-            return;
+
+        assert( target.isValid(free)==false || target.isDirty(free)==NOT_DIRTY );
+        target.place(free,address); // <----  W R I T E  the target level
+        if( dirty ) target.markDirty(free);
+
+        return free;
+    }
+
+
+
+    // the source level of a fill is read: touched - or, when it hands the block over, dropped
+    void release(std::size_t source, unsigned int sourceSlot, bool handedOver){
+        if( source==levels.size() ) return; // no-need for LRU-policy managing. read-request sent to Mem
+        if( handedOver ){
+            // the block moves up - a prefetched one does not pollute the level it leaves
+            if( levels[source].isPrefetched(sourceSlot) ) levels[source].clearPrefetched(sourceSlot);
+            levels[source].invalidate(sourceSlot);
         }
+        else{ levels[source].touch(sourceSlot);}
     }
-    
 
 
-    // acssessing the data in L2 cache, and fetching it into L1 cache after bringing it from main-Memory
-    void handle_L1_Miss(unsigned long int address, char operation){
-        std::vector<Block>& set = L1.getSet(address);
-        unsigned int occupiedWaysNum = 0;
-        for( unsigned int i=0 ; i<set.size() ; ++i ) occupiedWaysNum = (set[i].valid) ? (occupiedWaysNum+1) : (occupiedWaysNum);
-        
-        if( occupiedWaysNum < L1.totalWaysNum ){
-            putInFreeWay(address);
+
+    // vacates the victim slot of a level - due to it got Miss for capacity or compulsary.
+    // the victim goes down into an exclusive level below, and otherwise a dirty one is written back.
+    // the evictions and write-backs are always counted (they are reported and checkpointed), and
+    // the evictions of every set only when countSets
+    template<bool countSets>
+    void evacuateFrom(std::size_t level, unsigned int victim){
+        Cache& Li = levels[level];
+        unsigned long int evictedAddress = Li.addressOf(victim);
+        bool dirty = Li.isDirty(victim);
+        Li.clearDirty(victim);
+        ++Li.evictionsNum;
+        Li.writeBacksNum += dirty;
+        if( countSets ) ++Li.setEvictions[ victim/Li.totalWaysNum ];
+
+        if( level+1<levels.size() && levels[level+1].inclusion==EXCLUSIVE ){
+            putVictimIn<countSets>(level+1, evictedAddress, dirty);
         }
-        else{ assert( occupiedWaysNum == L1.totalWaysNum );
-            evacuateAndPut(address);
+        else if( dirty ){
+            writeBack(level+1, evictedAddress);
         }
-        
-        std::vector<Block>::iterator modified = L1.getBlock(address);
-        modified->dirtyBit = (operation==WRITE) ? DIRTY :  modified->dirtyBit;
-        return;
     }
-        
 
 
 
-    void L1_and_L2_Miss(unsigned long int address,char operation){
-        if ( (writePolicy==NO_WRITE_ALLOCATE) && (operation == WRITE) ){
-            /*      we "only" need to write the data into
-                      its address  in the main memory                  */
-                                return;
+    // writes a dirty block back into the first level (from 'level' down) that holds it, if any
+    void writeBack(std::size_t level, unsigned long int address){
+        for( ; level<levels.size() ; ++level ){
+            unsigned int slot = levels[level].getBlock(address);
+            if( slot!=NO_SLOT ){
+                levels[level].markDirty( levels[level].touch(slot) ); // write Li
+                return;
+            }
+        }
+        // written into the main memory
+        if( timed ) timing.writeToMemory();
+    }
+
+
+
+    // stores the victim of the level above in an exclusive level
+    template<bool countSets>
+    void putVictimIn(std::size_t level, unsigned long int address, bool dirty){
+        Cache& Li = levels[level];
+        unsigned int slot = Li.getBlock(address);
+        if( slot!=NO_SLOT ){
+            Li.touch(slot);
+        }
+        else if( Li.isSetFull(address)==false ){
+            slot = Li.place( Li.freeWayFor(address) , address );
+        }
+        else{
+            slot = Li.victimFor(address);
+            evacuateFrom<countSets>(level,slot);
+            Li.place(slot,address);
+        }
+        if( dirty ) Li.markDirty(slot);
+    }
+
+
+
+    // keeping coherent by asserting the evacuation of data from the levels above when evicting
+    // from an inclusive level
+    void snoopUpperLevels(std::size_t level, unsigned long int evictedAddress){
+        for( std::size_t upper=0 ; upper<level ; ++upper ){
+            unsigned int slot = levels[upper].getBlock(evictedAddress);
+            if( slot==NO_SLOT ) continue;
+
+            levels[upper].invalidate(slot);
+            ++levels[upper].backInvalidationsNum;
+            // if the data is dirty in the upper level     ===>>   "we assign" dirtyBit=DIRTY in this
+            // level when evicting its block                          (but its meaningless)
         }
-        assert( (writePolicy==WRITE_ALLOCATE) || (operation == READ) );
-        handle_L2_Miss(address);
-        handle_L1_Miss(address,operation);
     }
 };
 
@@ -0,0 +1,133 @@
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cacheSim.h"
+#include "traceReader.h"
+
+
+/*      the checkpoint format:
+            header:  "CSIMCKPT" | u32 version | u64 trace position (in accesses)
+                     | u64 format | u64 byte offset | u64 accesses to skip | u64 line number (a TraceOffset)
+            state:   the memory's configuration, and then the state of the memory itself
+        every struct hands its fields, in a fixed order, to an Archive through its checkpoint()
+        method - the same method saves and loads it. a field is a plain value or a whole array
+        (u64 length | its elements), that is written and read in a single bulk call. the
+        integers are in the machine's own byte order: a checkpoint is resumed where it was taken */
+//============================================================================================
+static const char CHECKPOINT_MAGIC[8] = { 'C','S','I','M','C','K','P','T' };
+static const std::uint32_t CHECKPOINT_VERSION = 4;   // 4: the trace's offset, next to its position
+
+
+
+/*      the Archive that saves a state into a checkpoint file     */
+//============================================================================================
+struct CheckpointWriter{
+    std::FILE* file;
+    bool ok;
+// ------------------------------------------------------------------------------------
+    explicit CheckpointWriter(std::FILE* file) : file(file), ok(file!=NULL){
+    }
+
+    template<class T>
+    void value(T& field){
+        ok = ok && std::fwrite(&field, sizeof(T), 1, file)==1;
+    }
+
+    template<class T>
+    void array(std::vector<T>& field){
+        std::uint64_t length = field.size();
+        value(length);
+        if( length!=0 ) ok = ok && std::fwrite(&field[0], sizeof(T), length, file)==length;
+    }
+};
+
+
+
+/*      the Archive that loads a state out of a checkpoint file. an array must have the length
+        that it has already - so the memory that is loaded must be built by the same
+        configuration - and any difference or short read fails the whole load            */
+//============================================================================================
+struct CheckpointReader{
+    std::FILE* file;
+    bool ok;
+// ------------------------------------------------------------------------------------
+    explicit CheckpointReader(std::FILE* file) : file(file), ok(file!=NULL){
+    }
+
+    template<class T>
+    void value(T& field){
+        ok = ok && std::fread(&field, sizeof(T), 1, file)==1;
+    }
+
+    template<class T>
+    void array(std::vector<T>& field){
+        std::uint64_t length = 0;
+        value(length);
+        ok = ok && length==field.size();
+        if( ok && length!=0 ) ok = std::fread(&field[0], sizeof(T), length, file)==length;
+    }
+};
+
+
+
+// saves the memory, the number of accesses of the trace that it went through and the offset of the
+// trace right after them (where a resumed run seeks to), into the file.
+// the checkpoint is written aside and renamed over the file, so a run that dies while writing it
+// leaves the previous checkpoint intact. returns false if it could not be written
+inline bool saveCheckpoint(const std::string& path, const MemoryConfig& config, Memory& memory,
+                           std::uint64_t position, const TraceOffset& offset){
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    CheckpointWriter archive(file);
+    char magic[8];
+    std::memcpy(magic, CHECKPOINT_MAGIC, sizeof(magic));
+    std::uint32_t version = CHECKPOINT_VERSION;
+    archive.value(magic);
+    archive.value(version);
+    archive.value(position);
+    TraceOffset point = offset;
+    archive.value(point.format);
+    archive.value(point.bytes);
+    archive.value(point.skip);
+    archive.value(point.lineNumber);
+    MemoryConfig saved = config;
+    saved.checkpoint(archive);
+    memory.checkpoint(archive);
+    if( file!=NULL && std::fclose(file)!=0 ) archive.ok = false;
+    return archive.ok && std::rename(temporary.c_str(), path.c_str())==0;
+}
+
+
+// loads a checkpoint of a memory that was built by the same configuration. sets 'position' to
+// the number of accesses of the trace that it went through, and 'offset' to the point of the trace
+// to resume from. returns false (and leaves the memory undefined) if the file is not a checkpoint
+// of this configuration - or its offset does not account for its position
+inline bool loadCheckpoint(const std::string& path, const MemoryConfig& config, Memory& memory,
+                           std::uint64_t& position, TraceOffset& offset){
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    CheckpointReader archive(file);
+    char magic[8] = { 0 };
+    std::uint32_t version = 0;
+    archive.value(magic);
+    archive.value(version);
+    archive.value(position);
+    archive.value(offset.format);
+    archive.value(offset.bytes);
+    archive.value(offset.skip);
+    archive.value(offset.lineNumber);
+    bool known = archive.ok && std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic))==0 && version==CHECKPOINT_VERSION
+              && offset.accesses()==position;
+    MemoryConfig saved = config;
+    if( known ) saved.checkpoint(archive);
+    bool same = known && archive.ok && saved.sameAs(config);
+    if( same ) memory.checkpoint(archive);
+    if( file!=NULL ) std::fclose(file);
+    return same && archive.ok;
+}
+
+#endif          //  CHECKPOINT_H_
@@ -0,0 +1,86 @@
+#ifndef CHUNK_WORKERS_H_
+#define CHUNK_WORKERS_H_
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+
+/*      a pool of worker-threads that every chunk of a trace is fanned out to, double buffered:
+        the calling thread prepares the next chunk into one buffer while the workers process the
+        current one out of the other. every worker takes a fixed share of every chunk (see Sweep
+        and ShardedMemory), so the chunks are processed in the trace order by each of them      */
+//============================================================================================
+struct ChunkWorkers{
+    const unsigned int workersNum;
+// workers' synchronization-------
+    std::mutex lock;
+    std::condition_variable chunkReady;
+    std::condition_variable chunkDone;
+    unsigned long int published;        // how many chunks were handed to the workers
+    unsigned int finishedWorkers;       // with the last published chunk
+    bool ended;                         // the last published chunk is the end of the trace
+// ------------------------------------------------------------------------------------
+    explicit ChunkWorkers(unsigned int workersNum) : workersNum(workersNum), published(0), finishedWorkers(0),
+            ended(false){
+    }
+
+
+    // runs the chunks through the workers: prepare(buffer) fills the next chunk into buffer 0 or 1
+    // (and returns false when the trace has no chunk left), and process(worker, buffer) is the
+    // share of worker 0..workersNum-1 of the chunk in that buffer. returns once all are processed
+    template<class Prepare, class Process>
+    void run(Prepare prepare, Process process){
+        std::vector<std::thread> workers;
+        for( unsigned int w=0 ; w<workersNum ; ++w ){
+            workers.push_back( std::thread( [this, w, &process]{ work(w, process); } ) );
+        }
+
+        bool more = prepare(0);
+        publish(!more);
+        while( more ){
+            // prepare the next chunk while the workers process the current one
+            more = prepare(published%2);
+
+            std::unique_lock<std::mutex> guard(lock);
+            chunkDone.wait( guard, [&]{ return finishedWorkers==workersNum; } );
+            guard.unlock();
+            publish(!more);
+        }
+
+        for( std::size_t w=0 ; w<workers.size() ; ++w ) workers[w].join();
+    }
+
+
+    // the body of a worker: processes its share of every chunk, until the end of the trace
+    template<class Process>
+    void work(unsigned int worker, Process& process){
+        unsigned long int seen = 0;
+        for(;;){
+            std::unique_lock<std::mutex> guard(lock);
+            chunkReady.wait( guard, [&]{ return published>seen; } );
+            seen = published;
+            bool last = ended;
+            guard.unlock();
+            if( last ) return;
+
+            process(worker, (std::size_t)(seen-1)%2);
+
+            guard.lock();
+            if( ++finishedWorkers==workersNum ) chunkDone.notify_one();
+        }
+    }
+
+
+    // hands the chunk in buffer published%2 to the workers (or the end of the trace)
+    void publish(bool last){
+        std::lock_guard<std::mutex> guard(lock);
+        ended = last;
+        finishedWorkers = 0;
+        ++published;
+        chunkReady.notify_all();
+    }
+};
+
+#endif          //  CHUNK_WORKERS_H_
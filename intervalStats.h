@@ -0,0 +1,118 @@
+#ifndef INTERVAL_STATS_H_
+#define INTERVAL_STATS_H_
+
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include "cacheSim.h"
+
+
+// the buckets of a conflict histogram: sets with 0 evictions, 1, 2-3, 4-7, ... 2^(k-1) or more
+static const unsigned int CONFLICT_BUCKETS = 16;
+
+
+
+/*      the counters of a level at the start of an interval     */
+//============================================================================================
+struct LevelCounters{
+    unsigned long int accesses;
+    unsigned long int misses;
+    unsigned long int evictions;
+    unsigned long int writeBacks;
+    unsigned long int backInvalidations;
+// ------------------------------------------------------------------------------------
+    LevelCounters() : accesses(0), misses(0), evictions(0), writeBacks(0), backInvalidations(0){
+    }
+
+    explicit LevelCounters(const Cache& level) : accesses(level.acssesNum), misses(level.missNum),
+            evictions(level.evictionsNum), writeBacks(level.writeBacksNum),
+            backInvalidations(level.backInvalidationsNum){
+    }
+};
+
+
+
+/*      reports the statistics of every interval of a run (K accesses each, and the rest at its end)
+        as lines of CSV or JSON into a stream of their own - a line per level: its hits, misses,
+        evictions, dirty write-backs and back-invalidations in the interval, the histogram of the
+        evictions over its sets, and the accesses per second that the simulation ran at.
+        the run stops between the intervals to emit them (see simulateFileInSegments), so the
+        simulation loop does not check anything per access; the levels only count the evictions
+        of every set while the statistics are on                                              */
+//============================================================================================
+struct IntervalStatistics{
+    std::FILE* out;
+    const bool json;
+    std::vector<LevelCounters> start;       // of the current interval
+    std::chrono::steady_clock::time_point startTime;
+    unsigned long int intervalsNum;
+// ------------------------------------------------------------------------------------
+    IntervalStatistics(std::FILE* out, bool json, Memory& memory) : out(out), json(json), intervalsNum(0){
+        for( std::size_t i=0 ; i<memory.levels.size() ; ++i ){
+            memory.levels[i].setEvictions.assign( memory.levels[i].setsNum , 0 );
+        }
+        if( !json ) std::fprintf(out, "interval,accesses,level,hits,misses,evictions,writebacks,"
+                                      "backinvalidations,conflicts,accesses_per_sec\n");
+        restart(memory);
+    }
+
+
+    // starts a new interval from the current counters of the memory
+    void restart(const Memory& memory){
+        start.clear();
+        for( std::size_t i=0 ; i<memory.levels.size() ; ++i ) start.push_back( LevelCounters(memory.levels[i]) );
+        startTime = std::chrono::steady_clock::now();
+    }
+
+
+    // the bucket of the conflict histogram of a set with that many evictions
+    static unsigned int bucketOf(unsigned int evictions){
+        unsigned int bucket = 0;
+        for( ; evictions!=0 && bucket<CONFLICT_BUCKETS-1 ; evictions >>= 1 ) ++bucket;
+        return bucket;
+    }
+
+
+    // emits the interval that ends after 'position' accesses of the trace, and starts the next one
+    void emit(Memory& memory, unsigned long int position){
+        double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+        unsigned long int accesses = start.empty() ? 0 : memory.levels[0].acssesNum - start[0].accesses;
+        double throughput = seconds>0 ? accesses/seconds : 0;
+
+        for( std::size_t i=0 ; i<memory.levels.size() ; ++i ){
+            Cache& level = memory.levels[i];
+            LevelCounters now(level);
+            unsigned long int misses = now.misses - start[i].misses;
+            unsigned long int hits = now.accesses - start[i].accesses - misses;
+
+            unsigned long int histogram[CONFLICT_BUCKETS] = { 0 };
+            for( std::size_t set=0 ; set<level.setEvictions.size() ; ++set ){
+                ++histogram[ bucketOf(level.setEvictions[set]) ];
+                level.setEvictions[set] = 0;
+            }
+            unsigned int buckets = CONFLICT_BUCKETS;
+            while( buckets>1 && histogram[buckets-1]==0 ) --buckets;
+
+            if( json ){
+                std::fprintf(out, "{\"interval\":%lu,\"accesses\":%lu,\"level\":%d,\"hits\":%lu,\"misses\":%lu,"
+                                  "\"evictions\":%lu,\"writebacks\":%lu,\"backinvalidations\":%lu,\"conflicts\":[",
+                             intervalsNum, position, (int)i+1, hits, misses, now.evictions - start[i].evictions,
+                             now.writeBacks - start[i].writeBacks, now.backInvalidations - start[i].backInvalidations);
+                for( unsigned int b=0 ; b<buckets ; ++b ) std::fprintf(out, b==0 ? "%lu" : ",%lu", histogram[b]);
+                std::fprintf(out, "],\"accesses_per_sec\":%.0f}\n", throughput);
+            }
+            else{
+                std::fprintf(out, "%lu,%lu,%d,%lu,%lu,%lu,%lu,%lu,", intervalsNum, position, (int)i+1, hits, misses,
+                             now.evictions - start[i].evictions, now.writeBacks - start[i].writeBacks,
+                             now.backInvalidations - start[i].backInvalidations);
+                for( unsigned int b=0 ; b<buckets ; ++b ) std::fprintf(out, b==0 ? "%lu" : ";%lu", histogram[b]);
+                std::fprintf(out, ",%.0f\n", throughput);
+            }
+        }
+        std::fflush(out);
+        ++intervalsNum;
+        restart(memory);
+    }
+};
+
+#endif          //  INTERVAL_STATS_H_
@@ -0,0 +1,191 @@
+#ifndef MULTICORE_H_
+#define MULTICORE_H_
+
+#include <vector>
+#include <cstdint>
+#include "cacheSim.h"
+
+
+// the most cores that a MultiCore simulates (the sharers of a block are a 64-bit mask)
+static const unsigned int MAX_CORES = 64;
+
+// MESI states of a block in a private L1
+static const std::uint8_t MESI_INVALID = 0;
+static const std::uint8_t MESI_SHARED = 1;
+static const std::uint8_t MESI_EXCLUSIVE = 2;
+static const std::uint8_t MESI_MODIFIED = 3;
+
+
+
+/*      the statistics of one simulated core     */
+//==================================================================
+struct CoreStatistics{
+    unsigned long int acssesNum;
+    unsigned long int missNum;      // in its L1
+    double totalTime;
+//------------------------------------------------------------------
+    CoreStatistics() : acssesNum(0), missNum(0), totalTime(0){
+    }
+};
+
+
+
+/*      a multi-core memory: every core has a private L1, and all of them share an inclusive L2
+        that keeps a MESI directory - the mask of the L1s that hold each of its blocks. so the
+        coherence messages go only to the actual sharers of a block, and an access costs the
+        same whatever the number of cores is. the caches are write-allocate                    */
+//============================================================================================
+struct MultiCore{
+// memory's levels----------------
+    std::vector<Cache> L1s;                             // of every core
+    std::vector< std::vector<std::uint8_t> > states;    // [core][slot in its L1]
+    Cache L2;
+    std::vector<std::uint64_t> sharers;                 // [slot in L2]: the L1s that hold the block
+    const unsigned long int cyclesNum;                  // of the main memory
+// for statistics-----------------
+    std::vector<CoreStatistics> cores;
+    unsigned long int invalidations;        // of L1 copies, by a write of another core
+    unsigned long int upgrades;             // writes to a shared copy
+    unsigned long int dirtyTransfers;       // modified blocks that were read out of another L1
+    unsigned long int backInvalidations;    // of L1 copies, by an L2 eviction
+//--------------------------------------------------------------------------------------------
+    MultiCore(const MemoryConfig& config, unsigned int coresNum) :
+            L2( config.levels[1].assoc, config.levels[1].size, config.blockSize, config.levels[1].cyc,
+                WRITE_ALLOCATE, INCLUSIVE, config.levels[1].replacement, config.seed + 1 ),
+            sharers( std::size_t(1) << (config.levels[1].size - config.blockSize), 0 ),
+            cyclesNum(config.memCyc), cores(coresNum),
+            invalidations(0), upgrades(0), dirtyTransfers(0), backInvalidations(0){
+        const LevelConfig& l1 = config.levels[0];
+        L1s.reserve(coresNum);
+        for( unsigned int c=0 ; c<coresNum ; ++c ){
+            L1s.push_back( Cache(l1.assoc, l1.size, config.blockSize, l1.cyc, WRITE_ALLOCATE, INCLUSIVE, l1.replacement,
+                                 config.seed) );
+            states.push_back( std::vector<std::uint8_t>( std::size_t(1) << (l1.size - config.blockSize), MESI_INVALID ) );
+        }
+    }
+
+
+
+    // runs one access of a core through the memory
+    void access(unsigned int core, unsigned long int address, char operation){
+        Cache& L1 = L1s[core];
+        CoreStatistics& statistics = cores[core];
+        ++statistics.acssesNum;
+        statistics.totalTime += L1.cyclesNum;
+
+        unsigned int slotInL1 = L1.getBlock(address);
+        if( slotInL1!=NO_SLOT ){
+            L1.touch(slotInL1);
+            std::uint8_t& state = states[core][slotInL1];
+            if( operation==WRITE && state!=MESI_MODIFIED ){
+                if( state==MESI_SHARED ){
+                    ++upgrades;
+                    invalidateOthers(core, address, L2.getBlock(address));
+                }
+                state = MESI_MODIFIED; // an exclusive one is upgraded silently
+            }
+            return;
+        }
+        ++statistics.missNum;
+
+        ++L2.acssesNum;
+        statistics.totalTime += L2.cyclesNum;
+        unsigned int slotInL2 = L2.getBlock(address);
+        if( slotInL2!=NO_SLOT ){
+            L2.touch(slotInL2);
+        }
+        else{
+            ++L2.missNum;
+            statistics.totalTime += cyclesNum;
+            slotInL2 = fillL2(address);
+        }
+
+        std::uint8_t state;
+        if( operation==WRITE ){
+            invalidateOthers(core, address, slotInL2);
+            state = MESI_MODIFIED;
+        }
+        else{
+            downgradeOthers(core, address, slotInL2);
+            state = (sharers[slotInL2]==0) ? MESI_EXCLUSIVE : MESI_SHARED;
+        }
+        fillL1(core, address, slotInL2, state);
+    }
+
+
+
+    // the other L1s that hold the block drop it; a modified copy is handed over on the way
+    void invalidateOthers(unsigned int core, unsigned long int address, unsigned int slotInL2){
+        std::uint64_t others = sharers[slotInL2] & ~(std::uint64_t(1) << core);
+        for( ; others!=0 ; others &= others-1 ){
+            unsigned int other = __builtin_ctzll(others);
+            unsigned int slot = L1s[other].getBlock(address);
+            if( states[other][slot]==MESI_MODIFIED ) ++dirtyTransfers;
+            states[other][slot] = MESI_INVALID;
+            L1s[other].invalidate(slot);
+            ++invalidations;
+        }
+        sharers[slotInL2] &= std::uint64_t(1) << core;
+    }
+
+
+    // for a read: the other L1s keep their copies as shared ones - a modified copy is written
+    // back into L2 and sent to the reader
+    void downgradeOthers(unsigned int core, unsigned long int address, unsigned int slotInL2){
+        std::uint64_t others = sharers[slotInL2] & ~(std::uint64_t(1) << core);
+        // a block with more than one sharer is shared already
+        if( others==0 || (others & (others-1))!=0 ) return;
+        unsigned int other = __builtin_ctzll(others);
+        std::uint8_t& state = states[other][ L1s[other].getBlock(address) ];
+        if( state==MESI_MODIFIED ){
+            ++dirtyTransfers;
+            L2.markDirty(slotInL2);
+        }
+        state = MESI_SHARED;
+    }
+
+
+    // brings the block from the main memory into L2. the L1 copies of its victim are back-invalidated
+    unsigned int fillL2(unsigned long int address){
+        unsigned int slot;
+        if( L2.isSetFull(address)==false ){
+            slot = L2.freeWayFor(address);
+        }
+        else{
+            slot = L2.victimFor(address);
+            unsigned long int evictedAddress = L2.addressOf(slot);
+            for( std::uint64_t holders=sharers[slot] ; holders!=0 ; holders &= holders-1 ){
+                unsigned int core = __builtin_ctzll(holders);
+                unsigned int slotInL1 = L1s[core].getBlock(evictedAddress);
+                states[core][slotInL1] = MESI_INVALID; // a modified copy goes to the main memory
+                L1s[core].invalidate(slotInL1);
+                ++backInvalidations;
+            }
+            L2.clearDirty(slot);
+        }
+        sharers[slot] = 0;
+        return L2.place(slot,address);
+    }
+
+
+    // brings the block from L2 into the core's L1, in the given state. a modified victim is written
+    // back into L2, and every victim leaves the directory
+    void fillL1(unsigned int core, unsigned long int address, unsigned int slotInL2, std::uint8_t state){
+        Cache& L1 = L1s[core];
+        unsigned int slot;
+        if( L1.isSetFull(address)==false ){
+            slot = L1.freeWayFor(address);
+        }
+        else{
+            slot = L1.victimFor(address);
+            unsigned int victimInL2 = L2.getBlock( L1.addressOf(slot) );
+            if( states[core][slot]==MESI_MODIFIED ) L2.markDirty( L2.touch(victimInL2) );
+            sharers[victimInL2] &= ~(std::uint64_t(1) << core);
+        }
+        L1.place(slot,address);
+        states[core][slot] = state;
+        sharers[slotInL2] |= std::uint64_t(1) << core;
+    }
+};
+
+#endif          //  MULTICORE_H_
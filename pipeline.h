@@ -0,0 +1,240 @@
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include "traceReader.h"
+
+
+// number of decoded batches that the reader thread may run ahead of the simulation
+static const std::size_t PIPELINE_DEPTH = 16;
+
+// number of times that a side yields, while the ring is empty (or full), before it blocks
+static const unsigned int PIPELINE_SPINS = 64;
+
+
+
+/*      a lock-free ring of CAPACITY slots between a single producer thread and a single
+        consumer thread. a side fills (or drains) the slot it was handed in place, and then
+        hands it over with a single release-store of its own index.
+        a side that has nothing to do spins for a while, and then parks (see await) - so a
+        slow trace, e.g. over NFS, does not keep the simulation's core busy. a hand-over only
+        takes the lock when the other side is parked                                        */
+//============================================================================================
+template<class T, std::size_t CAPACITY>
+struct SpscRing{
+    T slots[CAPACITY];
+    std::atomic<std::size_t> head;      // the next slot to be consumed (written by the consumer)
+    char apart[64];                     // keeps head and tail on different cache-lines
+    std::atomic<std::size_t> tail;      // the next slot to be produced (written by the producer)
+    std::atomic<bool> producerParked;   // blocks in await() while the ring is full
+    std::atomic<bool> consumerParked;   // blocks in await() while the ring is empty
+    std::mutex lock;                    // for a side that parks
+    std::condition_variable handedOver;
+// ------------------------------------------------------------------------------------
+    SpscRing() : head(0), tail(0), producerParked(false), consumerParked(false){
+    }
+
+    // the slot to fill next, or NULL while the ring is full
+    T* producing(){
+        std::size_t next = tail.load(std::memory_order_relaxed);
+        if( next - head.load(std::memory_order_acquire) == CAPACITY ) return NULL;
+        return &slots[next % CAPACITY];
+    }
+
+    void produced(){
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        wake(consumerParked);
+    }
+
+    // the slot to drain next, or NULL while the ring is empty
+    T* consuming(){
+        std::size_t next = head.load(std::memory_order_relaxed);
+        if( next == tail.load(std::memory_order_acquire) ) return NULL;
+        return &slots[next % CAPACITY];
+    }
+
+    void consumed(){
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        wake(producerParked);
+    }
+
+    // waits until ready() holds: yields PIPELINE_SPINS times, and then parks the side (its
+    // 'parked' flag) until the other side hands a slot over (or wakes it)
+    template<class Ready>
+    void await(std::atomic<bool>& parked, Ready ready){
+        for( unsigned int spin=0 ; spin<PIPELINE_SPINS ; ++spin ){
+            if( ready() ) return;
+            std::this_thread::yield();
+        }
+        parked.store(true, std::memory_order_relaxed);
+        // ordered against the fence in wake(): either ready() sees the hand-over, or wake() sees the flag
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if( !ready() ){
+            std::unique_lock<std::mutex> guard(lock);
+            handedOver.wait(guard, ready);
+        }
+        parked.store(false, std::memory_order_relaxed);
+    }
+
+    // wakes the side of the 'parked' flag, if it is parked. taking the lock orders it after that
+    // side checked ready() under it, so the wakeup is never lost
+    void wake(std::atomic<bool>& parked){
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if( !parked.load(std::memory_order_relaxed) ) return;
+        { std::lock_guard<std::mutex> guard(lock); }
+        handedOver.notify_all();
+    }
+};
+
+
+
+/*      one slot of the pipeline: a batch of decoded accesses. an empty batch ends the trace     */
+//============================================================================================
+struct AccessBatch{
+    Access accesses[TRACE_BATCH];
+    std::size_t size;
+    TraceOffset start;                  // of the trace, at the batch's first access
+    TraceOffset end;                    // right after its last one
+};
+
+
+
+/*      reads a trace with Reader (text or binary) on a thread of its own, that decodes batches
+        ahead into an SpscRing - so the file's I/O and parsing overlap with the simulation.
+        it has the interface of the readers themselves: read() hands out the decoded accesses,
+        and failed(), 'error' and 'lineNumber' report a malformed trace once read() returns 0.
+        the reader thread waits while the ring is full, and stops at the end of the trace, at
+        a malformed line, or when the PipelinedReader is destroyed                          */
+//============================================================================================
+template<class Reader>
+struct PipelinedReader{
+// pipeline's data----------------
+    Reader trace;                       // only the reader thread touches it while it runs
+    std::unique_ptr< SpscRing<AccessBatch,PIPELINE_DEPTH> > ring;
+    std::atomic<bool> stopping;
+    std::thread decoder;
+    AccessBatch* current;               // the batch that read() is draining
+    std::size_t position;               // inside the current batch
+    TraceOffset drained;                // of the trace, after the batches that read() drained
+    bool ended;
+// for error reporting-------------
+    unsigned long int lineNumber;
+    std::string error;
+// ------------------------------------------------------------------------------------
+    explicit PipelinedReader(const char* path) : trace(path), ring(new SpscRing<AccessBatch,PIPELINE_DEPTH>()),
+            stopping(false), current(NULL), position(0), ended(false), lineNumber(0){
+        start();
+    }
+
+    ~PipelinedReader(){
+        stop();
+    }
+
+    // starts the reader thread from the trace's current point
+    void start(){
+        drained = trace.offset();
+        if( !trace.good() || trace.failed() ){
+            finish();
+            return;
+        }
+        decoder = std::thread(&PipelinedReader::decode, this);
+    }
+
+    // stops the reader thread, wherever it is
+    void stop(){
+        stopping.store(true, std::memory_order_relaxed);
+        ring->wake(ring->producerParked);
+        if( decoder.joinable() ) decoder.join();
+    }
+
+    bool good() const{
+        return trace.good();
+    }
+
+    bool failed() const{
+        return !error.empty();
+    }
+
+
+    // the body of the reader thread
+    void decode(){
+        for(;;){
+            ring->await( ring->producerParked, [this]{ return ring->producing()!=NULL || stopping.load(std::memory_order_relaxed); } );
+            if( stopping.load(std::memory_order_relaxed) ) return;
+            AccessBatch* batch = ring->producing();
+            batch->start = trace.offset();
+            batch->size = trace.read(batch->accesses, TRACE_BATCH);
+            batch->end = trace.offset();
+            ring->produced();
+            if( batch->size==0 ) return;
+        }
+    }
+
+
+    // copies the reader's final state, once its thread is done with it
+    void finish(){
+        ended = true;
+        lineNumber = trace.lineNumber;
+        error = trace.error;
+    }
+
+
+    // hands out up to 'max' decoded accesses into 'out'. returns how many: 0 at the end of the
+    // trace, or when a malformed line was met (see failed())
+    std::size_t read(Access* out, std::size_t max){
+        std::size_t handed = 0;
+        while( handed<max && !ended ){
+            if( current==NULL ){
+                ring->await( ring->consumerParked, [this]{ return ring->consuming()!=NULL; } );
+                current = ring->consuming();
+                position = 0;
+                if( current->size==0 ){
+                    decoder.join();
+                    finish();
+                    break;
+                }
+            }
+            std::size_t count = std::min(max-handed, current->size-position);
+            std::copy(current->accesses+position, current->accesses+position+count, out+handed);
+            handed += count;
+            position += count;
+            if( position==current->size ){
+                drained = current->end;
+                current = NULL;
+                ring->consumed();
+            }
+        }
+        return handed;
+    }
+
+
+    // the point right after the accesses that read() handed out so far
+    TraceOffset offset() const{
+        if( current==NULL ) return drained;
+        return TraceOffset(current->start.format, current->start.bytes, current->start.skip + position,
+                           current->start.lineNumber);
+    }
+
+
+    // resumes the reading from the point (of an offset() of this very trace): the reader thread
+    // drops what it decoded ahead, and starts over from there. returns false if the trace does
+    // not reach it
+    bool seek(const TraceOffset& point){
+        stop();
+        ring.reset(new SpscRing<AccessBatch,PIPELINE_DEPTH>());
+        stopping.store(false, std::memory_order_relaxed);
+        current = NULL;
+        ended = false;
+        bool reached = !trace.failed() && trace.seek(point);
+        start();
+        return reached;
+    }
+};
+
+#endif          //  PIPELINE_H_
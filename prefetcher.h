@@ -0,0 +1,142 @@
+#ifndef PREFETCHER_H_
+#define PREFETCHER_H_
+
+#include <cstdint>
+
+
+// prefetchers of a cache-level
+static const int NO_PREFETCH = 0;
+static const int NEXT_LINE = 1;     // the blocks right after a missed one
+static const int STRIDE = 2;        // the next blocks of a steady stride in the level's access stream
+static const int STREAM = 3;        // runs ahead of up to STREAMS_NUM sequential miss-streams (see observeStream)
+static const int PREFETCHERS_NUM = 4;
+
+// the most blocks that a prefetcher may issue for a single access
+static const unsigned long int MAX_PREFETCH_DEGREE = 16;
+// the sequential streams that a STREAM prefetcher follows at once
+static const unsigned int STREAMS_NUM = 8;
+
+
+
+/*      a hardware prefetcher of a cache-level. it observes the blocks that the demand accesses
+        to its level ask for, and tells which blocks to prefetch into the level - 'degree' blocks
+        ahead. its state is a handful of words (STREAMS_NUM streams at most), so observing an
+        access costs O(1)                                                                       */
+//============================================================================================
+struct Prefetcher{
+    const int kind;
+    const unsigned long int degree;
+// STRIDE's state-----------------
+    std::int64_t lastBlock;
+    std::int64_t lastStride;
+    bool trained;
+// STREAM's state-----------------
+    struct Stream{
+        std::int64_t last;          // the last block of the stream that was asked for
+        std::int64_t direction;     // +1/-1, or 0 until the stream's second block
+        std::int64_t aheadUpTo;     // the last block of the stream that was prefetched
+        unsigned long int lastUse;
+        bool valid;
+    };
+    Stream streams[STREAMS_NUM];
+    unsigned long int clock;
+// ------------------------------------------------------------------------------------
+    Prefetcher(int kind=NO_PREFETCH, unsigned long int degree=1) : kind(kind),
+            degree( degree<MAX_PREFETCH_DEGREE ? degree : MAX_PREFETCH_DEGREE ),
+            lastBlock(0), lastStride(0), trained(false), clock(0){
+        for( unsigned int s=0 ; s<STREAMS_NUM ; ++s ) streams[s].valid = false;
+    }
+
+
+    // observes a demand access to the block. 'missed' is set when it missed in the level, or hit a
+    // block that was prefetched there. writes the blocks to prefetch into 'out' (room for
+    // MAX_PREFETCH_DEGREE), and returns how many
+    unsigned int observe(std::int64_t block, bool missed, std::int64_t* out){
+        switch( kind ){
+            case NEXT_LINE: return missed ? ahead(block, 1, 0, out) : 0;
+            case STRIDE:    return observeStride(block, missed, out);
+            case STREAM:    return missed ? observeStream(block, out) : 0;
+            default:        return 0;
+        }
+    }
+
+
+    // saves or loads the prefetcher's state (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        archive.value(lastBlock);
+        archive.value(lastStride);
+        archive.value(trained);
+        archive.value(streams);
+        archive.value(clock);
+    }
+
+
+    // the blocks block+step*(skip+1) ... block+step*degree
+    unsigned int ahead(std::int64_t block, std::int64_t step, unsigned long int skip, std::int64_t* out) const{
+        unsigned int count = 0;
+        for( unsigned long int k=skip+1 ; k<=degree ; ++k ){
+            std::int64_t next = block + step*(std::int64_t)k;
+            if( next>=0 ) out[count++] = next;
+        }
+        return count;
+    }
+
+
+    // trains on every access (repeated blocks aside), and issues on a miss once the same stride
+    // was seen twice in a row
+    unsigned int observeStride(std::int64_t block, bool missed, std::int64_t* out){
+        std::int64_t stride = block - lastBlock;
+        if( trained && stride==0 ) return 0;
+        bool steady = trained && stride==lastStride;
+        lastStride = stride;
+        lastBlock = block;
+        trained = true;
+        return (steady && missed) ? ahead(block, stride, 0, out) : 0;
+    }
+
+
+    // a miss that continues a stream (within its prefetched window) advances it, and tops the
+    // window up to 'degree' blocks ahead. a miss next to a new stream's block sets its direction,
+    // and any other miss starts a new stream instead of the least-recently-used one.
+    // a simplification of the stream buffers: the window is prefetched into the level itself,
+    // through its fill path, rather than into a separate buffer that a miss probes - so a stream
+    // that is not used takes the level's ways (and is counted as polluting when they are evicted)
+    unsigned int observeStream(std::int64_t block, std::int64_t* out){
+        ++clock;
+        Stream* replaced = &streams[0];
+        for( unsigned int s=0 ; s<STREAMS_NUM ; ++s ){
+            Stream& stream = streams[s];
+            if( !stream.valid ){
+                if( replaced->valid ) replaced = &stream;
+                continue;
+            }
+            if( replaced->valid && stream.lastUse<replaced->lastUse ) replaced = &stream;
+
+            std::int64_t distance = block - stream.last;
+            if( stream.direction==0 && (distance==1 || distance==-1) ){
+                stream.direction = distance;
+                stream.aheadUpTo = block;
+            }
+            else if( stream.direction==0 || distance*stream.direction<1
+                                         || distance*stream.direction>(std::int64_t)degree+1 ){
+                continue;
+            }
+            // skip the blocks of the window that were already prefetched
+            std::int64_t issued = (stream.aheadUpTo - block) * stream.direction;
+            stream.last = block;
+            stream.lastUse = clock;
+            unsigned int count = ahead(block, stream.direction, issued>0 ? issued : 0, out);
+            stream.aheadUpTo = block + stream.direction*(std::int64_t)degree;
+            return count;
+        }
+        replaced->valid = true;
+        replaced->last = block;
+        replaced->direction = 0;
+        replaced->aheadUpTo = block;
+        replaced->lastUse = clock;
+        return 0;
+    }
+};
+
+#endif          //  PREFETCHER_H_
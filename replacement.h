@@ -0,0 +1,232 @@
+#ifndef REPLACEMENT_H_
+#define REPLACEMENT_H_
+
+#include <vector>
+#include <cstdint>
+
+
+// replacement policies of a cache-level
+static const int LRU = 0;
+static const int TREE_PLRU = 1;     // a binary tree of ways-1 bits per set, that points away from recent ways
+static const int BIT_PLRU = 2;      // an MRU-bit per way, cleared in the whole set once all are set
+static const int SRRIP = 3;         // 2-bit re-reference prediction per way, inserting with a long interval
+static const int BRRIP = 4;         // as SRRIP, but inserting with a distant interval but for 1 in 32
+static const int FIFO = 5;
+static const int RANDOM = 6;        // seeded, so every run is repeatable
+static const int POLICIES_NUM = 7;
+
+// the re-reference prediction values of SRRIP/BRRIP
+static const std::uint8_t RRPV_DISTANT = 3;
+static const std::uint8_t RRPV_LONG = 2;
+// 1 in BRRIP_LONG_ODDS of the BRRIP insertions predict a long (rather than distant) re-reference
+static const std::uint64_t BRRIP_LONG_ODDS = 32;
+
+
+
+/*      Auxiliary struct for managing the LRU-policy (and FIFO) of a cache-level in O(1).
+        every set keeps an intrusive doubly-linked list of its ways, ordered
+        from the most-recently-used (head) to the least-recently-used (tail)        */
+//====================================================================================
+struct RecencyList{
+// list's data--------------------
+    std::vector<unsigned int> prev;     // indexed by set*ways+way
+    std::vector<unsigned int> next;     // indexed by set*ways+way
+    std::vector<unsigned int> head;     // indexed by set
+    std::vector<unsigned int> tail;     // indexed by set
+    const unsigned int ways;
+// ------------------------------------------------------------------------------------
+    RecencyList(unsigned long int setsNum, unsigned long int waysNum) :
+            prev(setsNum*waysNum), next(setsNum*waysNum), head(setsNum, 0),
+            tail(setsNum, waysNum-1), ways(waysNum){
+        for( unsigned long int i=0 ; i<setsNum*waysNum ; ++i ){
+            prev[i] = i % waysNum - 1; // wraps for the head - never read
+            next[i] = i % waysNum + 1; // equals ways for the tail - never read
+        }
+    }
+
+    // marks the way as the most-recently-used one of its set
+    void touch(unsigned long int set, unsigned int way){
+        unsigned int* setPrev = &prev[set*ways];
+        unsigned int* setNext = &next[set*ways];
+        if( head[set]==way ) return;
+
+        // unlink the way ...
+        setNext[ setPrev[way] ] = setNext[way];
+        if( tail[set]==way ){
+            tail[set] = setPrev[way];
+        }else{
+            setPrev[ setNext[way] ] = setPrev[way];
+        }
+        // ... and push it in front of the list
+        setNext[way] = head[set];
+        setPrev[ head[set] ] = way;
+        head[set] = way;
+    }
+
+    // gets the least-recently-used way of the set
+    unsigned int leastRecent(unsigned long int set) const{
+        return tail[set];
+    }
+
+    // saves or loads the lists (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        archive.array(prev);
+        archive.array(next);
+        archive.array(head);
+        archive.array(tail);
+    }
+};
+
+
+
+
+/*      the replacement state of a cache-level under one of the policies above, kept compactly
+        per set: linked ways (LRU/FIFO), bits (PLRU), 2-bit predictions (RRIP) or nothing at all
+        (random). the policy is fixed at construction; every operation is an inlined switch over
+        it - the same branch for a whole run - so there is no virtual dispatch per access        */
+//============================================================================================
+struct Replacement{
+    const int policy;
+    const unsigned long int ways;
+// policies' state----------------
+    RecencyList recency;                    // LRU, FIFO
+    std::vector<std::uint64_t> bits;        // TREE_PLRU (node n of a set at set*ways+n), BIT_PLRU
+    std::vector<unsigned int> setBitsNum;   // BIT_PLRU: the set bits of every set
+    std::vector<std::uint8_t> rrpv;         // SRRIP, BRRIP
+    std::uint64_t random;                   // BRRIP, RANDOM: xorshift64 state
+// ------------------------------------------------------------------------------------
+    Replacement(int policy, unsigned long int setsNum, unsigned long int waysNum, std::uint64_t seed) :
+            policy(policy), ways(waysNum),
+            recency( (policy==LRU || policy==FIFO) ? setsNum : 0 , waysNum ),
+            bits( (policy==TREE_PLRU || policy==BIT_PLRU) ? (setsNum*waysNum+63)/64 : 0 , 0 ),
+            setBitsNum( (policy==BIT_PLRU) ? setsNum : 0 , 0 ),
+            rrpv( (policy==SRRIP || policy==BRRIP) ? setsNum*waysNum : 0 , RRPV_DISTANT ),
+            random( seed*0x9E3779B97F4A7C15ull | 1 ){
+    }
+
+    // saves or loads the policy's state (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        recency.checkpoint(archive);
+        archive.array(bits);
+        archive.array(setBitsNum);
+        archive.array(rrpv);
+        archive.value(random);
+    }
+
+    std::uint64_t nextRandom(){
+        random ^= random << 13;
+        random ^= random >> 7;
+        random ^= random << 17;
+        return random;
+    }
+
+    bool bit(unsigned long int i) const{ return (bits[i/64] >> (i%64)) & 1; }
+    void setBit(unsigned long int i, bool value){
+        if( value ) bits[i/64] |= std::uint64_t(1) << (i%64);
+        else bits[i/64] &= ~(std::uint64_t(1) << (i%64));
+    }
+
+
+    // the way was accessed (hit)
+    void touch(unsigned long int set, unsigned int way){
+        switch( policy ){
+            case LRU:       recency.touch(set,way); break;
+            case TREE_PLRU: pointAwayFrom(set,way); break;
+            case BIT_PLRU:  markUsed(set,way); break;
+            case SRRIP:
+            case BRRIP:     rrpv[set*ways+way] = 0; break;
+            default:        break; // FIFO and RANDOM ignore hits
+        }
+    }
+
+
+    // a block was just placed in the way
+    void insert(unsigned long int set, unsigned int way){
+        switch( policy ){
+            case LRU:
+            case FIFO:      recency.touch(set,way); break;
+            case TREE_PLRU: pointAwayFrom(set,way); break;
+            case BIT_PLRU:  markUsed(set,way); break;
+            case SRRIP:     rrpv[set*ways+way] = RRPV_LONG; break;
+            case BRRIP:     rrpv[set*ways+way] = (nextRandom()%BRRIP_LONG_ODDS==0) ? RRPV_LONG : RRPV_DISTANT; break;
+            default:        break;
+        }
+    }
+
+
+    // chooses the way to evict out of a full set
+    unsigned int victim(unsigned long int set){
+        switch( policy ){
+            case LRU:
+            case FIFO:      return recency.leastRecent(set);
+            case TREE_PLRU: return followTree(set);
+            case BIT_PLRU:  return firstUnused(set);
+            case SRRIP:
+            case BRRIP:     return mostDistant(set);
+            default:        return nextRandom() & (ways-1);
+        }
+    }
+
+
+    // TREE_PLRU: every node on the way's path points to the other half
+    void pointAwayFrom(unsigned long int set, unsigned int way){
+        for( unsigned long int node=ways+way ; node>1 ; node>>=1 ){
+            setBit( set*ways + (node>>1) , (node&1)==0 );
+        }
+    }
+
+    // TREE_PLRU: follows the nodes from the root down to a leaf
+    unsigned int followTree(unsigned long int set) const{
+        unsigned long int node = 1;
+        while( node<ways ) node = 2*node + bit(set*ways+node);
+        return node - ways;
+    }
+
+
+    // BIT_PLRU: sets the way's bit - and once all are set, clears all the others
+    void markUsed(unsigned long int set, unsigned int way){
+        unsigned long int first = set*ways;
+        if( bit(first+way) ) return;
+        setBit(first+way, true);
+        if( ++setBitsNum[set] < ways ) return;
+        // the ways of a set share a word, or span whole words (ways is a power of 2)
+        if( ways<64 ){
+            bits[first/64] &= ~( ((std::uint64_t(1) << ways) - 1) << (first%64) );
+        }else{
+            for( unsigned long int word=first/64 ; word<(first+ways)/64 ; ++word ) bits[word] = 0;
+        }
+        setBit(first+way, true);
+        setBitsNum[set] = 1;
+    }
+
+    // BIT_PLRU: the first way whose bit is clear
+    unsigned int firstUnused(unsigned long int set) const{
+        if( ways==1 ) return 0;
+        unsigned long int first = set*ways;
+        for( unsigned long int i=first ; i<first+ways ; i=(i|63)+1 ){
+            std::uint64_t clear = ~bits[i/64] >> (i%64);
+            if( ways<64 ) clear &= (std::uint64_t(1) << ways) - 1;
+            if( clear!=0 ) return i - first + __builtin_ctzll(clear);
+        }
+        return 0; // not reached: a set always has a clear bit
+    }
+
+
+    // SRRIP/BRRIP: the first way predicted to be re-referenced in the distant future. when none
+    // is, all the set ages at once by as much as the nearest one needs
+    unsigned int mostDistant(unsigned long int set){
+        std::uint8_t* predictions = &rrpv[set*ways];
+        unsigned int way = 0;
+        for( unsigned int w=0 ; w<ways ; ++w ){
+            if( predictions[w]==RRPV_DISTANT ) return w;
+            if( predictions[w]>predictions[way] ) way = w;
+        }
+        std::uint8_t aging = RRPV_DISTANT - predictions[way];
+        for( unsigned int w=0 ; w<ways ; ++w ) predictions[w] += aging;
+        return way;
+    }
+};
+
+#endif          //  REPLACEMENT_H_
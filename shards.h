@@ -0,0 +1,116 @@
+#ifndef SHARDS_H_
+#define SHARDS_H_
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "cacheSim.h"
+#include "traceReader.h"
+#include "chunkWorkers.h"
+
+
+// number of accesses that are decoded together and dealt to the shards
+static const std::size_t SHARD_CHUNK = 1 << 16;
+
+
+
+/*      simulates a single memory configuration over a single trace, on many threads.
+        blocks that differ in the lowest bits of their set-index never meet: not in a set of any
+        level, and neither through the write-backs, the back-invalidations nor the victims that
+        move into exclusive levels (all of which stay with the evicted block's own bits). so the
+        trace is dealt by these bits into shards, and every shard runs on a Memory of its own
+        that holds only the sets of its blocks - the shard bits are dropped out of its addresses.
+        each worker-thread owns a fixed share of the shards, while the calling thread deals the
+        next chunk (see ChunkWorkers)                                                            */
+//============================================================================================
+struct ShardedMemory{
+// shards' data-------------------
+    const unsigned long int blockSize;  // log2(blockSize)
+    const unsigned long int shardBits;
+    std::vector< std::unique_ptr<Memory> > shards;
+    std::vector< std::vector<Access> > buffers[2];      // [buffer][shard]
+    std::vector<Access> decoded;
+// ------------------------------------------------------------------------------------
+    ShardedMemory(const MemoryConfig& config, unsigned long int shardBits) : blockSize(config.blockSize),
+            shardBits(shardBits), decoded(SHARD_CHUNK){
+        MemoryConfig shardConfig = config;
+        for( std::size_t i=0 ; i<shardConfig.levels.size() ; ++i ) shardConfig.levels[i].size -= shardBits;
+        for( unsigned long int s=0 ; s < (1ul << shardBits) ; ++s ){
+            shards.push_back( std::unique_ptr<Memory>(new Memory(shardConfig)) );
+        }
+        buffers[0].resize( shards.size() );
+        buffers[1].resize( shards.size() );
+    }
+
+
+    // the most shard bits that a configuration can be split by: the set-index bits of its smallest level
+    static unsigned long int maxShardBits(const MemoryConfig& config){
+        unsigned long int bits = ~0ul;
+        for( std::size_t i=0 ; i<config.levels.size() ; ++i ){
+            const LevelConfig& level = config.levels[i];
+            bits = std::min( bits , level.size - config.blockSize - level.assoc );
+        }
+        return bits;
+    }
+
+
+    // deals the accesses to the shards of the given buffer, in their trace order
+    void deal(const Access* accesses, std::size_t size, std::vector< std::vector<Access> >& buffer){
+        const unsigned long int mask = (1ul << shardBits) - 1;
+        for( std::size_t s=0 ; s<buffer.size() ; ++s ) buffer[s].clear();
+        for( std::size_t i=0 ; i<size ; ++i ){
+            unsigned long int block = accesses[i].address >> blockSize;
+            Access access;
+            access.address = (block >> shardBits) << blockSize;
+            access.operation = accesses[i].operation;
+            buffer[block & mask].push_back(access);
+        }
+    }
+
+
+    // runs the whole trace through the shards with up to threadsNum threads: a worker simulates
+    // shards w, w+workersNum, ... on every chunk.
+    // returns false if the trace turned out to be malformed (see the reader's error)
+    template<class Reader>
+    bool run(Reader& trace, unsigned int threadsNum){
+        unsigned int workersNum = std::max( 1u , std::min<unsigned int>(threadsNum, shards.size()) );
+
+        ChunkWorkers workers(workersNum);
+        workers.run(
+            [&](std::size_t buffer){
+                std::size_t size = trace.read(&decoded[0], SHARD_CHUNK);
+                deal(&decoded[0], size, buffers[buffer]);
+                return size!=0;
+            },
+            [&](unsigned int worker, std::size_t buffer){
+                for( std::size_t s=worker ; s<shards.size() ; s+=workersNum ){
+                    Memory& memory = *shards[s];
+                    const std::vector<Access>& accesses = buffers[buffer][s];
+                    for( std::size_t i=0 ; i<accesses.size() ; ++i ){
+                        memory.access(accesses[i].address, accesses[i].operation);
+                    }
+                }
+            });
+        return !trace.failed();
+    }
+
+
+    // adds the statistics of every shard up into the first one, and returns it
+    const Memory& merge(){
+        Memory& total = *shards[0];
+        for( std::size_t s=1 ; s<shards.size() ; ++s ){
+            for( std::size_t i=0 ; i<total.levels.size() ; ++i ){
+                total.levels[i].missNum += shards[s]->levels[i].missNum;
+                total.levels[i].acssesNum += shards[s]->levels[i].acssesNum;
+                total.levels[i].evictionsNum += shards[s]->levels[i].evictionsNum;
+                total.levels[i].writeBacksNum += shards[s]->levels[i].writeBacksNum;
+                total.levels[i].backInvalidationsNum += shards[s]->levels[i].backInvalidationsNum;
+            }
+            total.totalTime += shards[s]->totalTime;
+            total.acessNum += shards[s]->acessNum;
+        }
+        return total;
+    }
+};
+
+#endif          //  SHARDS_H_
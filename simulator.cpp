@@ -0,0 +1,69 @@
+/* 046267 Computer Architecture - Winter 20/21 - HW #2 */
+
+#include "simulator.h"
+
+/*	the geometries that get a compile-time decoded access path, as
+	X(blockBits, L1 setBits, L1 wayBits, L2 setBits, L2 wayBits).
+	defaults to the examples/ configurations - nightly builds pass their own list with -D	*/
+#ifndef NIGHTLY_GEOMETRIES
+#define NIGHTLY_GEOMETRIES(X)	X(3,0,1,3,0)	X(4,1,1,2,2)
+#endif
+
+
+/* runs the accesses through the memory, probing L1/L2 with the given decode plans (and counting the
+   evictions of every set when countSets) */
+template<bool countSets, class L1Plan, class L2Plan>
+static void accessEach(Memory& memory, const Access* accesses, std::size_t size, const L1Plan& decode1,
+                       const L2Plan& decode2) {
+	for (std::size_t i = 0; i < size; ++i) {
+		memory.access<countSets>(accesses[i].address, accesses[i].operation, decode1, decode2);
+	}
+}
+
+
+/* the per-set eviction counts are compiled into the access path only while the interval statistics are on */
+template<class L1Plan, class L2Plan>
+static void accessBatch(Memory& memory, const Access* accesses, std::size_t size, const L1Plan& decode1,
+                        const L2Plan& decode2) {
+	if (memory.countsSetEvictions()) accessEach<true>(memory, accesses, size, decode1, decode2);
+	else accessEach<false>(memory, accesses, size, decode1, decode2);
+}
+
+
+void accessBatch(Memory& memory, const Access* accesses, std::size_t size) {
+#define ACCESS_IF_NIGHTLY(b, s1, w1, s2, w2) \
+	if (FixedDecodePlan<b,s1,w1>::matches(memory.levels[0].plan) && FixedDecodePlan<b,s2,w2>::matches(memory.levels[1].plan)) \
+		return accessBatch(memory, accesses, size, FixedDecodePlan<b,s1,w1>(), FixedDecodePlan<b,s2,w2>());
+	NIGHTLY_GEOMETRIES(ACCESS_IF_NIGHTLY)
+#undef ACCESS_IF_NIGHTLY
+	accessBatch(memory, accesses, size, memory.levels[0].plan, memory.levels[1].plan);
+}
+
+
+SimulatorStatistics statisticsOf(const Memory& memory) {
+	SimulatorStatistics statistics;
+	for (std::size_t i = 0; i < memory.levels.size(); ++i) {
+		const Cache& level = memory.levels[i];
+		LevelStatistics counted;
+		counted.accesses = level.acssesNum;
+		counted.misses = level.missNum;
+		counted.evictions = level.evictionsNum;
+		counted.writeBacks = level.writeBacksNum;
+		counted.backInvalidations = level.backInvalidationsNum;
+		counted.prefetching = (memory.prefetchers[i].kind != NO_PREFETCH);
+		counted.prefetchIssued = level.prefetchIssued;
+		counted.prefetchUseful = level.prefetchUseful;
+		counted.prefetchLate = level.prefetchLate;
+		counted.prefetchPolluting = level.prefetchPolluting;
+		statistics.levels.push_back(counted);
+	}
+	statistics.accesses = (unsigned long int)memory.acessNum;
+	statistics.totalTime = memory.totalTime;
+
+	statistics.timed = memory.timed;
+	statistics.cycles = memory.timing.cycles();
+	statistics.averageLatency = memory.timing.averageLatency();
+	statistics.bandwidth = memory.timing.bandwidth();
+	statistics.stallCycles = memory.timing.stallCycles;
+	return statistics;
+}
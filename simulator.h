@@ -0,0 +1,91 @@
+#ifndef SIMULATOR_H_
+#define SIMULATOR_H_
+
+#include <vector>
+#include <cstddef>
+#include "cacheSim.h"
+#include "traceReader.h"
+
+
+/*      the statistics of a cache-level, as counted since the start of the run (or its warmup)     */
+//============================================================================================
+struct LevelStatistics{
+    unsigned long int accesses;
+    unsigned long int misses;
+    unsigned long int evictions;
+    unsigned long int writeBacks;           // evictions of dirty blocks
+    unsigned long int backInvalidations;
+    bool prefetching;                       // the level has a prefetcher
+    unsigned long int prefetchIssued;
+    unsigned long int prefetchUseful;
+    unsigned long int prefetchLate;
+    unsigned long int prefetchPolluting;
+// ------------------------------------------------------------------------------------
+    double missRate() const{
+        return (double)misses/accesses;
+    }
+};
+
+
+
+/*      the statistics of the whole memory structure: of every level (levels[0] is L1), the
+        serialized access time, and the timing model's - when it is on                          */
+//============================================================================================
+struct SimulatorStatistics{
+    std::vector<LevelStatistics> levels;
+    unsigned long int accesses;
+    double totalTime;
+// the timing model's------------
+    bool timed;
+    double cycles;
+    double averageLatency;
+    double bandwidth;                       // bytes per cycle
+    double stallCycles;
+// ------------------------------------------------------------------------------------
+    double averageAccessTime() const{
+        return totalTime/accesses;
+    }
+};
+
+
+// reads the statistics of a memory
+SimulatorStatistics statisticsOf(const Memory& memory);
+
+// runs the accesses through the memory, in their order - through a compile-time decoded path
+// when its geometry is a nightly one (see NIGHTLY_GEOMETRIES in simulator.cpp)
+void accessBatch(Memory& memory, const Access* accesses, std::size_t size);
+
+
+
+/*      THE interface of the simulator library: a memory structure that is built by a
+        configuration (see MemoryConfig::set for its command-line flags), that is fed with
+        accesses one at a time or by whole batches - straight from a trace reader or from
+        any other instrumentation - and that reports its statistics.
+        'memory' is the structure itself, for the tools that checkpoint or inspect it           */
+//============================================================================================
+struct Simulator{
+    Memory memory;
+// ------------------------------------------------------------------------------------
+    explicit Simulator(const MemoryConfig& config) : memory(config){
+    }
+
+    // an access of the cpu: operation is READ ('r') or WRITE ('w')
+    void access(char operation, unsigned long int address){
+        memory.access(address, operation);
+    }
+
+    // a batch of accesses, in their order
+    void accessBatch(const Access* accesses, std::size_t size){
+        ::accessBatch(memory, accesses, size);
+    }
+
+    void accessBatch(const std::vector<Access>& accesses){
+        if( !accesses.empty() ) accessBatch(&accesses[0], accesses.size());
+    }
+
+    SimulatorStatistics statistics() const{
+        return statisticsOf(memory);
+    }
+};
+
+#endif          //  SIMULATOR_H_
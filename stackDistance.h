@@ -0,0 +1,162 @@
+#ifndef STACK_DISTANCE_H_
+#define STACK_DISTANCE_H_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+#include "cacheSim.h"
+
+
+static const std::uint64_t DEAD_ENTRY = ~std::uint64_t(0);
+// the smallest capacity of a set's time-line (it is grown/compacted as needed)
+static const unsigned long int MIN_TIMELINE = 64;
+
+
+
+/*      Fenwick (binary-indexed) tree of counters, for prefix-sums in O(log n)      */
+//====================================================================================
+struct FenwickTree{
+    std::vector<unsigned int> tree;
+//-----------------------------------------------------------------------------------
+    explicit FenwickTree(unsigned long int size=0) : tree(size+1, 0){
+    }
+
+    void add(unsigned long int index, int delta){
+        for( ++index ; index<tree.size() ; index += index & (0-index) ) tree[index] += delta;
+    }
+
+    // sums the counters in [0,index)
+    unsigned long int prefix(unsigned long int index) const{
+        unsigned long int sum = 0;
+        for( ; index>0 ; index -= index & (0-index) ) sum += tree[index];
+        return sum;
+    }
+};
+
+
+
+/*      the top of the LRU stack of one cache-set, kept as a time-line: every block of the
+        set marks the (set-local) time of its latest access. the stack distance of a re-access
+        is the number of marks after the previous access of its block                       */
+//==========================================================================================
+struct SetStack{
+    FenwickTree marks;
+    std::vector<std::uint64_t> blockAt;     // the block whose latest access is at each time
+    unsigned long int now;
+    unsigned long int live;                 // marked times (= blocks in the stack)
+    unsigned long int oldest;               // no live mark is before it
+//------------------------------------------------------------------------------------------
+    SetStack() : marks(MIN_TIMELINE), blockAt(MIN_TIMELINE, DEAD_ENTRY), now(0), live(0), oldest(0){
+    }
+
+    // drops the least-recently-used block out of the stack, and returns it
+    std::uint64_t dropOldest(){
+        while( blockAt[oldest]==DEAD_ENTRY ) ++oldest;
+        std::uint64_t block = blockAt[oldest];
+        blockAt[oldest] = DEAD_ENTRY;
+        marks.add(oldest, -1);
+        --live;
+        return block;
+    }
+
+    // renumbers the live marks as 0..live-1 into a time-line with room for as many more,
+    // and updates the times kept for their blocks
+    void compact(std::unordered_map<std::uint64_t,unsigned long int>& lastAccess){
+        unsigned long int capacity = std::max(MIN_TIMELINE, 2*live);
+        std::vector<std::uint64_t> compacted(capacity, DEAD_ENTRY);
+        FenwickTree rebuilt(capacity);
+        unsigned long int time = 0;
+        for( unsigned long int t=0 ; t<now ; ++t ){
+            if( blockAt[t]==DEAD_ENTRY ) continue;
+            compacted[time] = blockAt[t];
+            rebuilt.add(time, 1);
+            lastAccess[ blockAt[t] ] = time++;
+        }
+        blockAt.swap(compacted);
+        marks.tree.swap(rebuilt.tree);
+        now = time;
+        oldest = 0;
+    }
+};
+
+
+
+/*      computes, in a single pass, the stack distances of every access under LRU for caches
+        with 2^setBits sets of 2^blockBits-byte blocks, and their histogram - which gives the
+        miss-ratio of all the associativities (thus all the sizes) with these set-index bits.
+        distances of maxWays and up miss in every cache asked about, so each set keeps only
+        the top maxWays blocks of its stack, and the deeper ones count as first accesses      */
+//==========================================================================================
+struct StackDistance{
+// engine's data------------------
+    const DecodePlan plan;
+    std::vector<SetStack> sets;
+    std::unordered_map<std::uint64_t,unsigned long int> lastAccess;   // block -> set-local time
+    const unsigned long int maxWays;
+// for statistics-----------------
+    std::vector<unsigned long int> histogram;     // [distance] for distances below maxWays
+    unsigned long int farNum;                     // first accesses, and distances of maxWays and up
+    unsigned long int acssesNum;
+//------------------------------------------------------------------------------------------
+    StackDistance(unsigned long int blockBits, unsigned long int setBits, unsigned long int maxWays) :
+            plan(blockBits, setBits, 0), sets(1ul << setBits), maxWays(maxWays), histogram(maxWays, 0),
+            farNum(0), acssesNum(0){
+    }
+
+    void access(unsigned long int address){
+        std::uint64_t block = address >> plan.setShift;
+        SetStack& set = sets[ plan.setIndex(address) ];
+        ++acssesNum;
+
+        if( set.now==set.blockAt.size() ) set.compact(lastAccess);
+
+        std::unordered_map<std::uint64_t,unsigned long int>::iterator last = lastAccess.find(block);
+        if( last==lastAccess.end() ){
+            ++farNum;
+            if( set.live==maxWays ) lastAccess.erase( set.dropOldest() );
+            ++set.live;
+            lastAccess.insert( std::make_pair(block,set.now) );
+        }else{
+            unsigned long int distance = set.marks.prefix(set.now) - set.marks.prefix(last->second+1);
+            ++histogram[distance]; // the stack holds at most maxWays blocks: distance < maxWays
+            set.marks.add(last->second, -1);
+            set.blockAt[last->second] = DEAD_ENTRY;
+            last->second = set.now;
+        }
+        set.marks.add(set.now, 1);
+        set.blockAt[set.now++] = block;
+    }
+
+    // misses of an LRU cache with 2^setBits sets of 'ways' ways (up to maxWays)
+    unsigned long int missNum(unsigned long int ways) const{
+        unsigned long int misses = farNum;
+        for( unsigned long int distance=ways ; distance<histogram.size() ; ++distance ){
+            misses += histogram[distance];
+        }
+        return misses;
+    }
+
+    double missRate(unsigned long int ways) const{
+        return (double)missNum(ways) / acssesNum;
+    }
+};
+
+
+
+/*      runs an access through a single, stand-alone, write-allocate LRU cache-level.
+        this is the reference that the StackDistance results are validated against.
+        returns true on a hit                                                            */
+//==========================================================================================
+inline bool accessSingleLevel(Cache& cache, unsigned long int address){
+    unsigned int slot = cache.getBlock(address);
+    if( slot!=NO_SLOT ){
+        cache.touch(slot);
+        return true;
+    }
+    slot = cache.isSetFull(address) ? cache.victimFor(address) : cache.freeWayFor(address);
+    cache.place(slot,address);
+    return false;
+}
+
+#endif          //  STACK_DISTANCE_H_
@@ -0,0 +1,64 @@
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <vector>
+#include <memory>
+#include "cacheSim.h"
+#include "traceReader.h"
+#include "chunkWorkers.h"
+
+
+// number of accesses that are decoded together and handed to every configuration
+static const std::size_t SWEEP_CHUNK = 1 << 16;
+
+
+
+/*      simulates many memory configurations over a single pass of the trace.
+        the trace is decoded once, chunk by chunk, and every chunk is fanned out to all the
+        configurations: each worker-thread owns a fixed share of the Memory instances, while
+        the calling thread decodes the next chunk into a second buffer (see ChunkWorkers)         */
+//============================================================================================
+struct Sweep{
+// sweep's data-------------------
+    std::vector< std::unique_ptr<Memory> > memories;   // one per configuration, in order
+    std::vector<Access> buffers[2];
+    std::size_t sizes[2];               // of the chunks in the buffers
+// ------------------------------------------------------------------------------------
+    explicit Sweep(const std::vector<MemoryConfig>& configs){
+        for( std::size_t i=0 ; i<configs.size() ; ++i ){
+            memories.push_back( std::unique_ptr<Memory>(new Memory(configs[i])) );
+        }
+        buffers[0].resize(SWEEP_CHUNK);
+        buffers[1].resize(SWEEP_CHUNK);
+    }
+
+
+    // runs the whole trace through every configuration with up to threadsNum threads: a worker
+    // simulates configurations w, w+workersNum, ... on every chunk.
+    // returns false if the trace turned out to be malformed (see the reader's error)
+    template<class Reader>
+    bool run(Reader& trace, unsigned int threadsNum){
+        unsigned int workersNum = threadsNum;
+        if( workersNum>memories.size() ) workersNum = memories.size();
+        if( workersNum==0 ) workersNum = 1;
+
+        ChunkWorkers workers(workersNum);
+        workers.run(
+            [&](std::size_t buffer){
+                sizes[buffer] = trace.read(&buffers[buffer][0], SWEEP_CHUNK);
+                return sizes[buffer]!=0;
+            },
+            [&](unsigned int worker, std::size_t buffer){
+                const Access* chunk = &buffers[buffer][0];
+                for( std::size_t m=worker ; m<memories.size() ; m+=workersNum ){
+                    Memory& memory = *memories[m];
+                    for( std::size_t i=0 ; i<sizes[buffer] ; ++i ){
+                        memory.access(chunk[i].address, chunk[i].operation);
+                    }
+                }
+            });
+        return !trace.failed();
+    }
+};
+
+#endif          //  SWEEP_H_
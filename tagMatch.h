@@ -0,0 +1,87 @@
+#ifndef TAG_MATCH_H_
+#define TAG_MATCH_H_
+
+#include <cstdint>
+
+#if ( defined(__x86_64__) || defined(__i386__) ) && defined(__GNUC__)
+#include <immintrin.h>
+#define TAG_MATCH_X86
+#endif
+
+
+/*      kernels for finding a tag inside the packed tag-array of a cache-set.
+        every kernel returns the matching way, or 'ways' if no way holds the tag.
+        the vectorized kernels are compiled for their own instruction-set, and
+        the best one that the running cpu supports is chosen at runtime              */
+//====================================================================================
+typedef unsigned long int (*TagMatchKernel)(const std::uint64_t* tags, unsigned long int ways, std::uint64_t tag);
+
+
+inline unsigned long int matchTagScalar(const std::uint64_t* tags, unsigned long int ways, std::uint64_t tag){
+    for( unsigned long int way=0 ; way<ways ; ++way ){
+        if( tags[way]==tag ) return way;
+    }
+    return ways;
+}
+
+
+
+#ifdef TAG_MATCH_X86
+
+// SSE2 has no 64-bit compare: a lane matches when both of its 32-bit halves match
+__attribute__((target("sse2")))
+inline unsigned long int matchTagSSE2(const std::uint64_t* tags, unsigned long int ways, std::uint64_t tag){
+    const __m128i key = _mm_set1_epi64x( (long long)tag );
+    unsigned long int way = 0;
+    for( ; way+2<=ways ; way+=2 ){
+        __m128i lanes = _mm_loadu_si128( (const __m128i*)(tags+way) );
+        int mask = _mm_movemask_epi8( _mm_cmpeq_epi32(lanes,key) );
+        if( (mask & 0x00FF)==0x00FF ) return way;
+        if( (mask & 0xFF00)==0xFF00 ) return way+1;
+    }
+    return (way<ways && tags[way]==tag) ? way : ways;
+}
+
+
+__attribute__((target("avx2")))
+inline unsigned long int matchTagAVX2(const std::uint64_t* tags, unsigned long int ways, std::uint64_t tag){
+    const __m256i key = _mm256_set1_epi64x( (long long)tag );
+    unsigned long int way = 0;
+    for( ; way+8<=ways ; way+=8 ){
+        __m256i low = _mm256_cmpeq_epi64( _mm256_loadu_si256((const __m256i*)(tags+way)) , key );
+        __m256i high = _mm256_cmpeq_epi64( _mm256_loadu_si256((const __m256i*)(tags+way+4)) , key );
+        int mask = _mm256_movemask_pd( _mm256_castsi256_pd(low) )
+                 | _mm256_movemask_pd( _mm256_castsi256_pd(high) ) << 4;
+        if( mask!=0 ) return way + __builtin_ctz(mask);
+    }
+    for( ; way+4<=ways ; way+=4 ){
+        __m256i lanes = _mm256_cmpeq_epi64( _mm256_loadu_si256((const __m256i*)(tags+way)) , key );
+        int mask = _mm256_movemask_pd( _mm256_castsi256_pd(lanes) );
+        if( mask!=0 ) return way + __builtin_ctz(mask);
+    }
+    for( ; way<ways ; ++way ){
+        if( tags[way]==tag ) return way;
+    }
+    return ways;
+}
+
+#endif          //  TAG_MATCH_X86
+
+
+
+// sets with fewer ways than this are probed with an inlined scalar loop
+static const unsigned long int VECTOR_MATCH_MIN_WAYS = 4;
+
+
+// picks the fastest kernel for a set of 'ways' tags on the running cpu
+inline TagMatchKernel bestTagMatchKernel(unsigned long int ways){
+    if( ways<VECTOR_MATCH_MIN_WAYS ) return matchTagScalar;
+#ifdef TAG_MATCH_X86
+    __builtin_cpu_init();
+    if( __builtin_cpu_supports("avx2") ) return matchTagAVX2;
+    if( __builtin_cpu_supports("sse2") ) return matchTagSSE2;
+#endif
+    return matchTagScalar;
+}
+
+#endif          //  TAG_MATCH_H_
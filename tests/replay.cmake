@@ -0,0 +1,38 @@
+# replays recorded runs of cacheSim, and fails on any output that differs from the recorded one.
+# every case is a command file (a "./cacheSim <arguments>" line) next to its expected output.
+#   cmake -DCACHESIM=<cacheSim> -DCASES=<glob of command files> -DCOMMAND_SUFFIX=<suffix>
+#         -DEXPECTED_SUFFIX=<suffix> -DWORKING_DIRECTORY=<directory> -P replay.cmake
+# (tests/*.command against *.OURS - the outputs of this simulator, which differ from the course's
+#  reference *.out in the --vic-cache 1 runs, having no victim cache, and in test284, test492 and
+#  test876 - see README.md - and examples/*_command against *_output)
+file(GLOB commands "${CASES}")
+list(LENGTH commands casesNum)
+if(casesNum EQUAL 0)
+    message(FATAL_ERROR "no cases match ${CASES}")
+endif()
+
+set(failed "")
+foreach(command ${commands})
+    file(READ "${command}" line)
+    string(STRIP "${line}" line)
+    string(REGEX REPLACE "^\\./cacheSim +" "" line "${line}")
+    separate_arguments(arguments UNIX_COMMAND "${line}")
+    execute_process(COMMAND "${CACHESIM}" ${arguments} WORKING_DIRECTORY "${WORKING_DIRECTORY}"
+                    OUTPUT_VARIABLE output ERROR_VARIABLE errors)
+
+    string(REGEX REPLACE "${COMMAND_SUFFIX}$" "${EXPECTED_SUFFIX}" expectedFile "${command}")
+    file(READ "${expectedFile}" expected)
+    string(STRIP "${output}" output)
+    string(STRIP "${expected}" expected)
+    if(NOT output STREQUAL expected)
+        get_filename_component(name "${command}" NAME)
+        list(APPEND failed "${name}")
+        message("${name}: got \"${output}\", expected \"${expected}\"")
+    endif()
+endforeach()
+
+list(LENGTH failed failedNum)
+if(failedNum GREATER 0)
+    message(FATAL_ERROR "${failedNum} of ${casesNum} cases differ")
+endif()
+message("all ${casesNum} cases match")
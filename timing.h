@@ -0,0 +1,206 @@
+#ifndef TIMING_H_
+#define TIMING_H_
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+
+/*      the miss-status holding registers of a cache-level: every entry holds an outstanding miss
+        (its block, and the time at which the block arrives) until it is served               */
+//============================================================================================
+struct MshrFile{
+    std::vector<std::uint64_t> blocks;
+    std::vector<double> doneAt;
+// ------------------------------------------------------------------------------------
+    explicit MshrFile(unsigned long int entriesNum=1) : blocks(entriesNum, 0), doneAt(entriesNum, 0){
+    }
+
+    // the time at which a miss to the block that is still outstanding at 'now' is served (else 0)
+    double pending(std::uint64_t block, double now) const{
+        for( std::size_t e=0 ; e<blocks.size() ; ++e ){
+            if( blocks[e]==block && doneAt[e]>now ) return doneAt[e];
+        }
+        return 0;
+    }
+
+    // the earliest time, from 'now' on, at which an entry is free
+    double freeAt(double now) const{
+        return std::max( now , *std::min_element(doneAt.begin(), doneAt.end()) );
+    }
+
+    // holds a miss to the block in the entry that frees first (see freeAt)
+    void allocate(std::uint64_t block, double done){
+        std::size_t e = std::min_element(doneAt.begin(), doneAt.end()) - doneAt.begin();
+        blocks[e] = block;
+        doneAt[e] = done;
+    }
+
+    // saves or loads the entries (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        archive.array(blocks);
+        archive.array(doneAt);
+    }
+};
+
+
+
+/*      an optional timing model of the memory structure, next to its serialized totalTime.
+        the cpu issues an access every cycle and does not wait for its misses (so they overlap),
+        but it stalls while a level that misses has no free MSHR, and while the write-back
+        buffer is full. the blocks move over a single memory channel of a limited bandwidth,
+        the reads and the write-backs alike, in the order that they are sent                     */
+//============================================================================================
+struct TimingModel{
+// model's parameters-------------
+    std::vector<MshrFile> mshrs;            // of every level
+    std::vector<double> levelCycles;        // of every level
+    double memoryCycles;
+    double transferCycles;                  // of a block over the memory channel
+    unsigned long int blockBytes;
+// model's state------------------
+    std::vector<double> writeBuffer;        // the time at which every entry is drained
+    double now;                             // the issue time of the current access
+    double channelFree;
+    double lastDone;
+// for statistics-----------------
+    double start;                           // the issue time of the first access that is counted
+    double latencySum;
+    double stallCycles;
+    unsigned long int accessesNum;
+    unsigned long int memoryReads;
+    unsigned long int memoryWrites;
+// ------------------------------------------------------------------------------------
+    TimingModel() : memoryCycles(0), transferCycles(0), blockBytes(0), now(0), channelFree(0), lastDone(0),
+            start(0), latencySum(0), stallCycles(0), accessesNum(0), memoryReads(0), memoryWrites(0){
+    }
+
+    // bandwidth is in bytes per cycle (0 for an unlimited one)
+    TimingModel(const std::vector<unsigned long int>& mshrsNum, const std::vector<double>& cycles,
+                double memoryCycles, unsigned long int blockBytes, unsigned long int bandwidth,
+                unsigned long int writeBufferSize) :
+            levelCycles(cycles), memoryCycles(memoryCycles),
+            transferCycles( bandwidth==0 ? 0 : (double)blockBytes/bandwidth ), blockBytes(blockBytes),
+            writeBuffer(writeBufferSize, 0), now(0), channelFree(0), lastDone(0),
+            start(0), latencySum(0), stallCycles(0), accessesNum(0), memoryReads(0), memoryWrites(0){
+        for( std::size_t i=0 ; i<mshrsNum.size() ; ++i ) mshrs.push_back( MshrFile(mshrsNum[i]) );
+    }
+
+
+    // the cpu waits until 'time'
+    void stallUntil(double time){
+        if( time<=now ) return;
+        stallCycles += time - now;
+        now = time;
+    }
+
+
+    // a block that reaches the main memory at 'arrival' is read over the channel. returns when it is back
+    double readFromMemory(double arrival){
+        double start = std::max( arrival + memoryCycles , channelFree );
+        channelFree = start + transferCycles;
+        ++memoryReads;
+        return channelFree;
+    }
+
+
+    // a block is written to the main memory through the write-back buffer
+    void writeToMemory(){
+        std::vector<double>::iterator entry = std::min_element(writeBuffer.begin(), writeBuffer.end());
+        stallUntil(*entry); // the buffer is full
+        double start = std::max( now , channelFree );
+        channelFree = start + transferCycles;
+        *entry = channelFree;
+        ++memoryWrites;
+    }
+
+
+    // times the current access: the levels before 'holder' (levels.size() for the main memory)
+    // missed, and the block was filled into levels top..holder-1 (none when top==holder)
+    void complete(std::uint64_t block, std::size_t holder, std::size_t top){
+        std::size_t levelsNum = levelCycles.size();
+        double probe = 0;
+        for( std::size_t i=0 ; i<=holder && i<levelsNum ; ++i ) probe += levelCycles[i];
+
+        // every level that gets the block fills it through an MSHR of its own
+        for( std::size_t i=top ; i<holder ; ++i ) stallUntil( mshrs[i].freeAt(now) );
+
+        double done = now + probe;
+        if( holder<levelsNum ){
+            // the block may still be on its way into the holder (a secondary miss)
+            done = std::max( done , mshrs[holder].pending(block, now) );
+        }
+        else if( top<holder ){
+            done = readFromMemory(now + probe);
+        }
+        for( std::size_t i=top ; i<holder ; ++i ) mshrs[i].allocate(block, done);
+
+        latencySum += done - now;
+        lastDone = std::max( lastDone , done );
+        ++accessesNum;
+        now += 1;
+    }
+
+
+    // times a prefetch of the block into 'level', out of 'holder' (levels.size() for the main memory),
+    // that the current access issues. it waits for a free MSHR in every level that it fills - the cpu
+    // does not - and holds them until the block arrives. returns the time at which it does
+    double prefetch(std::uint64_t block, std::size_t level, std::size_t holder){
+        std::size_t levelsNum = levelCycles.size();
+        double issue = now;
+        for( std::size_t i=level ; i<holder ; ++i ) issue = std::max( issue , mshrs[i].freeAt(now) );
+
+        double probe = 0;
+        for( std::size_t i=level+1 ; i<=holder && i<levelsNum ; ++i ) probe += levelCycles[i];
+        double done = (holder<levelsNum) ? std::max( issue + probe , mshrs[holder].pending(block, issue) )
+                                         : readFromMemory(issue + probe);
+        for( std::size_t i=level ; i<holder ; ++i ) mshrs[i].allocate(block, done);
+        return done;
+    }
+
+
+    // the cycles from the first counted access until the last one is served
+    double cycles() const{
+        return std::max( now , lastDone ) - start;
+    }
+
+
+    // counts from the next access on (the earlier ones warmed the model up)
+    void resetStatistics(){
+        start = now;
+        latencySum = 0;
+        stallCycles = 0;
+        accessesNum = 0;
+        memoryReads = 0;
+        memoryWrites = 0;
+    }
+
+
+    // saves or loads the model's state (see checkpoint.h)
+    template<class Archive>
+    void checkpoint(Archive& archive){
+        for( std::size_t i=0 ; i<mshrs.size() ; ++i ) mshrs[i].checkpoint(archive);
+        archive.array(writeBuffer);
+        archive.value(now);
+        archive.value(channelFree);
+        archive.value(lastDone);
+        archive.value(start);
+        archive.value(latencySum);
+        archive.value(stallCycles);
+        archive.value(accessesNum);
+        archive.value(memoryReads);
+        archive.value(memoryWrites);
+    }
+
+    double averageLatency() const{
+        return accessesNum==0 ? 0 : latencySum/accessesNum;
+    }
+
+    // bytes per cycle, moved over the memory channel
+    double bandwidth() const{
+        return cycles()==0 ? 0 : (double)(memoryReads+memoryWrites)*blockBytes/cycles();
+    }
+};
+
+#endif          //  TIMING_H_
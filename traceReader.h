@@ -0,0 +1,271 @@
+#ifndef TRACE_READER_H_
+#define TRACE_READER_H_
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define TRACE_READER_MMAP
+#endif
+
+
+/*      one decoded line of the trace: the operation ('r' or 'w') and its address      */
+//====================================================================================
+struct Access{
+    unsigned long int address;
+    char operation;
+};
+
+
+// the formats of the traces, as their offsets are in
+static const std::uint64_t TEXT_TRACE = 0;
+static const std::uint64_t BINARY_TRACE = 1;
+
+
+
+/*      a point of a trace that a reader may resume from (see checkpoint.h): the byte offset
+        of a line of a text trace or of a chunk of a binary one, the accesses to skip from
+        there on, and the reader's lineNumber at that offset                               */
+//====================================================================================
+struct TraceOffset{
+    std::uint64_t format;
+    std::uint64_t bytes;
+    std::uint64_t skip;
+    std::uint64_t lineNumber;
+// ------------------------------------------------------------------------------------
+    TraceOffset(std::uint64_t format=TEXT_TRACE, std::uint64_t bytes=0, std::uint64_t skip=0,
+                std::uint64_t lineNumber=0) : format(format), bytes(bytes), skip(skip), lineNumber(lineNumber){
+    }
+
+    // the number of accesses of the trace before this point
+    std::uint64_t accesses() const{
+        return lineNumber + skip;
+    }
+};
+
+
+// number of accesses that the simulation loop pulls out of the reader at once
+static const std::size_t TRACE_BATCH = 4096;
+
+
+// reads and drops the next 'count' accesses of a reader. returns false if the trace ends (or
+// fails) before them
+template<class Reader>
+bool skipAccesses(Reader& trace, std::uint64_t count){
+    Access dropped[256];
+    while( count>0 ){
+        std::size_t got = trace.read(dropped, count<256 ? count : 256);
+        if( got==0 ) return false;
+        count -= got;
+    }
+    return true;
+}
+// size of the chunks read from the trace when it cannot be memory-mapped
+static const std::size_t TRACE_CHUNK = 1 << 20;
+
+
+
+/*      reads a text trace of "operation 0xADDRESS" lines without any per-line allocation:
+        the file is memory-mapped when possible (or else read in large chunks), and every
+        line is parsed in place. a malformed line stops the reading, and is reported
+        through 'error' and 'lineNumber'                                                  */
+//=========================================================================================
+struct TraceReader{
+// reader's data------------------
+    std::FILE* file;
+    const char* mapped;             // the whole file, when it is memory-mapped
+    std::size_t mappedSize;
+    std::vector<char> chunk;        // the current chunk, when it is not
+    const char* cursor;
+    const char* end;
+    bool endOfFile;
+    std::uint64_t chunkOffset;      // of the chunk's first byte in the file, when it is not mapped
+// for error reporting-------------
+    unsigned long int lineNumber;
+    std::string error;
+// ------------------------------------------------------------------------------------
+    explicit TraceReader(const char* path) : file(NULL), mapped(NULL), mappedSize(0),
+            cursor(NULL), end(NULL), endOfFile(false), chunkOffset(0), lineNumber(0){
+        file = std::fopen(path, "rb");
+        if( file==NULL ) return;
+#ifdef TRACE_READER_MMAP
+        struct stat info;
+        int fd = fileno(file);
+        if( fstat(fd,&info)==0 && S_ISREG(info.st_mode) && info.st_size>0 ){
+            void* view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if( view!=MAP_FAILED ){
+                madvise(view, info.st_size, MADV_SEQUENTIAL);
+                mapped = static_cast<const char*>(view);
+                mappedSize = info.st_size;
+                cursor = mapped;
+                end = mapped + mappedSize;
+                endOfFile = true;
+                return;
+            }
+        }
+#endif
+        chunk.resize(TRACE_CHUNK);
+        cursor = end = &chunk[0];
+    }
+
+    ~TraceReader(){
+#ifdef TRACE_READER_MMAP
+        if( mapped!=NULL ) munmap(const_cast<char*>(mapped), mappedSize);
+#endif
+        if( file!=NULL ) std::fclose(file);
+    }
+
+    // checks if the trace was opened
+    bool good() const{
+        return file!=NULL;
+    }
+
+    bool failed() const{
+        return !error.empty();
+    }
+
+
+    // decodes up to 'max' accesses into 'out'. returns how many were decoded: 0 at the end
+    // of the trace, or when a malformed line was met (see failed())
+    std::size_t read(Access* out, std::size_t max){
+        std::size_t decoded = 0;
+        const char* lineBegin;
+        const char* lineEnd;
+        while( decoded<max && failed()==false && nextLine(lineBegin,lineEnd) ){
+            ++lineNumber;
+            if( parseLine(lineBegin,lineEnd,out[decoded]) ) ++decoded;
+        }
+        return decoded;
+    }
+
+
+    // the point right after the accesses that were read so far
+    TraceOffset offset() const{
+        std::uint64_t bytes = (mapped!=NULL) ? cursor - mapped : chunkOffset + (cursor - &chunk[0]);
+        return TraceOffset(TEXT_TRACE, bytes, 0, lineNumber);
+    }
+
+
+    // resumes the reading from the point (of an offset() of this very trace).
+    // returns false if the trace does not reach it, or it is not the start of a line
+    bool seek(const TraceOffset& point){
+        if( point.format!=TEXT_TRACE ) return false;
+        if( mapped!=NULL ){
+            if( point.bytes>mappedSize || (point.bytes>0 && mapped[point.bytes-1]!='\n') ) return false;
+            cursor = mapped + point.bytes;
+        }else{
+            if( file==NULL || std::fseek(file, (long)point.bytes, SEEK_SET)!=0 ) return false;
+            chunkOffset = point.bytes;
+            cursor = end = &chunk[0];
+            endOfFile = false;
+        }
+        lineNumber = point.lineNumber;
+        return skipAccesses(*this, point.skip);
+    }
+
+
+    // reads the next chunk of the file, keeping the unfinished line at its beginning
+    void refill(){
+        chunkOffset += cursor - &chunk[0];
+        std::size_t kept = end - cursor;
+        if( kept==chunk.size() ) chunk.resize( 2*chunk.size() ); // a line longer than a chunk
+        std::memmove(&chunk[0], cursor, kept);
+        std::size_t got = std::fread(&chunk[kept], 1, chunk.size()-kept, file);
+        endOfFile = (got < chunk.size()-kept);
+        cursor = &chunk[0];
+        end = cursor + kept + got;
+    }
+
+
+    // finds the bounds of the next line (without its '\n'). returns false at the end of the trace
+    bool nextLine(const char*& lineBegin, const char*& lineEnd){
+        const char* newLine;
+        while( (newLine = static_cast<const char*>(std::memchr(cursor, '\n', end-cursor)))==NULL ){
+            if( endOfFile ){
+                if( cursor==end ) return false;
+                newLine = end; // the last line has no '\n'
+                break;
+            }
+            refill();
+        }
+        lineBegin = cursor;
+        lineEnd = newLine;
+        cursor = (newLine==end) ? end : newLine+1;
+        return true;
+    }
+
+
+    static bool isBlank(char c){
+        return c==' ' || c=='\t' || c=='\r';
+    }
+
+
+    bool fail(const char* reason){
+        error = reason;
+        return false;
+    }
+
+
+    // parses "operation [0x]hex-address" - surrounding blanks are allowed
+    bool parseLine(const char* p, const char* lineEnd, Access& access){
+        while( p<lineEnd && isBlank(*p) ) ++p;
+        if( p==lineEnd ) return fail("empty line");
+
+        char operation = *p++ | 0x20; // 'R'/'W' are accepted as well
+        if( operation!='r' && operation!='w' ) return fail("the operation is neither 'r' nor 'w'");
+        while( p<lineEnd && isBlank(*p) ) ++p;
+
+        if( lineEnd-p>=2 && p[0]=='0' && (p[1]|0x20)=='x' ) p += 2;
+        const char* digits = p;
+        unsigned long int address = 0;
+        for( ; p<lineEnd ; ++p ){
+            unsigned int digit;
+            if( *p>='0' && *p<='9' ) digit = *p - '0';
+            else if( (*p|0x20)>='a' && (*p|0x20)<='f' ) digit = (*p|0x20) - 'a' + 10;
+            else break;
+            address = (address << 4) | digit;
+        }
+        if( p==digits ) return fail("missing hexadecimal address");
+        if( (std::size_t)(p-digits) > 2*sizeof(address) ) return fail("the address is too wide");
+
+        while( p<lineEnd && isBlank(*p) ) ++p;
+        if( p!=lineEnd ) return fail("unexpected characters after the address");
+
+        access.address = address;
+        access.operation = operation;
+        return true;
+    }
+};
+
+
+
+/*      hands out no more than 'remaining' accesses of another reader (of any kind), so that a
+        trace may be simulated a segment at a time                                          */
+//====================================================================================
+template<class Reader>
+struct LimitedReader{
+    Reader& trace;
+    unsigned long int remaining;
+// ------------------------------------------------------------------------------------
+    LimitedReader(Reader& trace, unsigned long int limit) : trace(trace), remaining(limit){
+    }
+
+    bool failed() const{
+        return trace.failed();
+    }
+
+    std::size_t read(Access* out, std::size_t max){
+        std::size_t decoded = trace.read(out, max<remaining ? max : remaining);
+        remaining -= decoded;
+        return decoded;
+    }
+};
+
+#endif          //  TRACE_READER_H_
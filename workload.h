@@ -0,0 +1,288 @@
+#ifndef WORKLOAD_H_
+#define WORKLOAD_H_
+
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include "cacheSim.h"
+#include "traceReader.h"
+
+
+// the synthetic workloads: every one walks a footprint of 2^footprintBits bytes, a block per access
+static const int SEQUENTIAL = 0;    // block after block, wrapping around
+static const int STRIDED = 1;       // 'stride' blocks apart, shifted by a block on every wrap
+static const int UNIFORM = 2;       // uniformly random blocks
+static const int ZIPFIAN = 3;       // blocks of Zipf-distributed popularity, scattered over the footprint
+static const int POINTER_CHASE = 4; // a random cycle through all the blocks, a block per link
+static const int WORKLOADS_NUM = 5;
+
+static const char* const WORKLOAD_NAMES[WORKLOADS_NUM] = { "sequential", "strided", "uniform", "zipfian", "chase" };
+
+// the skew of the ZIPFIAN workload (as YCSB's)
+static const double ZIPF_EXPONENT = 0.99;
+
+
+
+/*      draws ranks 1..n of a Zipf distribution in O(1) each, without any table: by
+        rejection-inversion (Hormann and Derflinger) - a sample is an inversion of the integral
+        of the distribution's hat function, and is rarely rejected                         */
+//============================================================================================
+struct ZipfSampler{
+    double exponent;
+    double n;
+    double hIntegralX1;
+    double hIntegralN;
+    double s;
+// ------------------------------------------------------------------------------------
+    ZipfSampler(std::uint64_t elementsNum=1, double exponent=ZIPF_EXPONENT) : exponent(exponent),
+            n((double)elementsNum){
+        hIntegralX1 = hIntegral(1.5) - 1;
+        hIntegralN = hIntegral(n + 0.5);
+        s = 2 - hIntegralInverse(hIntegral(2.5) - h(2));
+    }
+
+    // a rank out of a uniform draw in [0,1) - that is drawn again (by next01) when rejected
+    template<class Uniform>
+    std::uint64_t sample(Uniform& next01) const{
+        for(;;){
+            double u = hIntegralN + next01() * (hIntegralX1 - hIntegralN);
+            double x = hIntegralInverse(u);
+            double k = std::floor(x + 0.5);
+            if( k<1 ) k = 1;
+            else if( k>n ) k = n;
+            if( k-x<=s || u>=hIntegral(k + 0.5) - h(k) ) return (std::uint64_t)k;
+        }
+    }
+
+    double h(double x) const{
+        return std::exp(-exponent * std::log(x));
+    }
+
+    double hIntegral(double x) const{
+        double logX = std::log(x);
+        return helper2((1 - exponent) * logX) * logX;
+    }
+
+    double hIntegralInverse(double x) const{
+        double t = x * (1 - exponent);
+        if( t<-1 ) t = -1;
+        return std::exp(helper1(t) * x);
+    }
+
+    // log(1+x)/x, and (exp(x)-1)/x - accurate near 0
+    static double helper1(double x){
+        return std::fabs(x)>1e-8 ? std::log1p(x)/x : 1 - x*(0.5 - x*(1.0/3 - 0.25*x));
+    }
+
+    static double helper2(double x){
+        return std::fabs(x)>1e-8 ? std::expm1(x)/x : 1 + x*0.5*(1 + x/3*(1 + 0.25*x));
+    }
+};
+
+
+
+/*      a synthetic stream of accesses - deterministic by its seed - that is generated in process
+        straight into the simulator's batches, instead of being read out of a trace file.
+        writePercent of the accesses are writes (drawn at random), and the rest are reads.
+        a batch is generated by a loop of its own kind, and takes no memory but the batch: the
+        pointer chase follows a full-period LCG over the blocks (so every block is a link of a
+        single cycle) through a fixed bijective scramble, instead of a table of links            */
+//============================================================================================
+struct Workload{
+    const int kind;
+    const unsigned long int blockBits;
+    const std::uint64_t blocksMask;         // of the footprint's blocks
+    const std::uint64_t stride;             // in blocks
+    const std::uint64_t writeThreshold;     // out of 2^32
+    std::uint64_t random;                   // xorshift64* state
+    std::uint64_t position;                 // SEQUENTIAL, STRIDED: the next block
+    std::uint64_t pass;                     // STRIDED: the wraps around the footprint so far
+    const unsigned int halfBits;            // POINTER_CHASE: of the footprint's blocks, rounded up
+    ZipfSampler zipf;
+// ------------------------------------------------------------------------------------
+    Workload(int kind, unsigned long int footprintBits, unsigned long int blockBits, std::uint64_t stride=1,
+             unsigned int writePercent=0, std::uint64_t seed=1) : kind(kind), blockBits(blockBits),
+            blocksMask( (std::uint64_t(1) << (footprintBits - blockBits)) - 1 ), stride(stride),
+            writeThreshold( (std::uint64_t(writePercent) << 32) / 100 ), random( seed*0x9E3779B97F4A7C15ull | 1 ),
+            position(0), pass(0), halfBits( (footprintBits - blockBits + 1) / 2 ),
+            zipf( kind==ZIPFIAN ? blocksMask+1 : 1 ){
+    }
+
+    std::uint64_t nextRandom(){
+        random ^= random >> 12;
+        random ^= random << 25;
+        random ^= random >> 27;
+        return random * 0x2545F4914F6CDD1Dull;
+    }
+
+    // a uniform draw in [0,1)
+    double operator()(){
+        return (nextRandom() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    // the next link of the pointer chase: the LCG steps over all the blocks (its increment is odd
+    // and its multiplier is 1 mod 4), and the scramble - odd multipliers and an xor-shift, all of
+    // them bijections of the footprint's blocks - scatters its steps over the sets
+    std::uint64_t nextLink(){
+        position = (position * 6364136223846793005ull + 1442695040888963407ull) & blocksMask;
+        std::uint64_t link = (position * 0x9E3779B97F4A7C15ull) & blocksMask;
+        link ^= link >> halfBits;
+        return (link * 0xBF58476D1CE4E5B9ull) & blocksMask;
+    }
+
+    std::uint64_t nextBlock(){
+        std::uint64_t block;
+        switch( kind ){
+            case SEQUENTIAL:
+                block = position;
+                position = (position + 1) & blocksMask;
+                return block;
+            case STRIDED:
+                block = position;
+                position += stride;
+                if( position>blocksMask ) position = ++pass % stride;
+                return block & blocksMask;
+            case UNIFORM:
+                return nextRandom() & blocksMask;
+            case ZIPFIAN:
+                // the popular ranks are scattered over the sets by an odd multiplier (a bijection)
+                return ((zipf.sample(*this) - 1) * 0x9E3779B97F4A7C15ull) & blocksMask;
+            default:
+                return nextLink();
+        }
+    }
+
+    char nextOperation(){
+        return (writeThreshold!=0 && (nextRandom() >> 32) < writeThreshold) ? WRITE : READ;
+    }
+
+    // generates the next 'size' accesses into 'out'
+    void fill(Access* out, std::size_t size){
+        switch( kind ){
+            case SEQUENTIAL:
+                for( std::size_t i=0 ; i<size ; ++i ){
+                    out[i].address = position << blockBits;
+                    position = (position + 1) & blocksMask;
+                }
+                break;
+            case UNIFORM:
+                for( std::size_t i=0 ; i<size ; ++i ) out[i].address = (nextRandom() & blocksMask) << blockBits;
+                break;
+            case POINTER_CHASE:
+                for( std::size_t i=0 ; i<size ; ++i ) out[i].address = nextLink() << blockBits;
+                break;
+            default:
+                for( std::size_t i=0 ; i<size ; ++i ) out[i].address = nextBlock() << blockBits;
+                break;
+        }
+        if( writeThreshold==0 ){
+            for( std::size_t i=0 ; i<size ; ++i ) out[i].operation = READ;
+        }
+        else{
+            for( std::size_t i=0 ; i<size ; ++i ) out[i].operation = nextOperation();
+        }
+    }
+};
+
+
+
+/*      a mix of workloads over the same footprint: every access comes out of one of them, drawn
+        by their weights (a single workload is generated by whole batches, with no draws).
+        it is spelled "<name>[:<weight>],..." - e.g. "zipfian:80,sequential:20"                 */
+//============================================================================================
+struct WorkloadMix{
+    std::vector<Workload> parts;
+    std::vector<std::uint64_t> thresholds;  // the cumulative weights, out of 2^32
+    std::uint64_t random;                   // xorshift64* state
+// ------------------------------------------------------------------------------------
+    WorkloadMix() : random(1){
+    }
+
+    // parses the mix. returns false for an unknown workload or a bad weight
+    bool parse(const std::string& spec, unsigned long int footprintBits, unsigned long int blockBits,
+               std::uint64_t stride, unsigned int writePercent, std::uint64_t seed){
+        std::vector<unsigned long int> weights;
+        std::size_t begin = 0;
+        while( begin<=spec.size() ){
+            std::size_t end = spec.find(',', begin);
+            if( end==std::string::npos ) end = spec.size();
+            std::string part = spec.substr(begin, end-begin);
+            std::size_t colon = part.find(':');
+            std::string name = part.substr(0, colon);
+            unsigned long int weight = 1;
+            if( colon!=std::string::npos ){
+                char* last;
+                weight = std::strtoul(part.c_str()+colon+1, &last, 10);
+                if( *last!='\0' || weight==0 ) return false;
+            }
+            int kind = 0;
+            while( kind<WORKLOADS_NUM && name!=WORKLOAD_NAMES[kind] ) ++kind;
+            if( kind==WORKLOADS_NUM ) return false;
+            // every part gets a seed of its own
+            parts.push_back( Workload(kind, footprintBits, blockBits, stride, writePercent, seed + parts.size()) );
+            weights.push_back(weight);
+            begin = end+1;
+        }
+
+        unsigned long int total = 0;
+        for( std::size_t p=0 ; p<weights.size() ; ++p ) total += weights[p];
+        unsigned long int sum = 0;
+        for( std::size_t p=0 ; p<weights.size() ; ++p ){
+            sum += weights[p];
+            thresholds.push_back( (std::uint64_t(sum) << 32) / total );
+        }
+        random = seed*0x9E3779B97F4A7C15ull | 1;
+        return true;
+    }
+
+    std::uint64_t nextRandom(){
+        random ^= random >> 12;
+        random ^= random << 25;
+        random ^= random >> 27;
+        return random * 0x2545F4914F6CDD1Dull;
+    }
+
+    // generates the next 'size' accesses into 'out'
+    void fill(Access* out, std::size_t size){
+        if( parts.size()==1 ) return parts[0].fill(out, size);
+        for( std::size_t i=0 ; i<size ; ++i ){
+            std::uint64_t draw = nextRandom() >> 32;
+            std::size_t p = 0;
+            while( draw>=thresholds[p] ) ++p;
+            out[i].address = parts[p].nextBlock() << parts[p].blockBits;
+            out[i].operation = parts[p].nextOperation();
+        }
+    }
+};
+
+
+
+/*      hands out 'accessesNum' accesses of a workload mix through the interface of the trace
+        readers, so that a generated run is simulated just like a trace                        */
+//============================================================================================
+struct WorkloadReader{
+    WorkloadMix& workload;
+    unsigned long int remaining;
+    unsigned long int lineNumber;       // a generated workload is never malformed
+    std::string error;
+// ------------------------------------------------------------------------------------
+    WorkloadReader(WorkloadMix& workload, unsigned long int accessesNum) : workload(workload),
+            remaining(accessesNum), lineNumber(0){
+    }
+
+    bool failed() const{
+        return false;
+    }
+
+    std::size_t read(Access* out, std::size_t max){
+        std::size_t size = max<remaining ? max : remaining;
+        workload.fill(out, size);
+        remaining -= size;
+        return size;
+    }
+};
+
+#endif          //  WORKLOAD_H_